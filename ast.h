@@ -14,6 +14,7 @@
 #define AST_H
 
 #include <list>
+#include <vector>
 
 //----------------------------------------------------------------------
 // Visitor interface
@@ -33,6 +34,7 @@ class ReturnStmt;
 class IfStmt;
 class WhileStmt;
 class ForStmt;
+class ParForStmt;
 class Expr;
 class SimpleTerm;
 class ComplexTerm;
@@ -41,6 +43,8 @@ class NewRValue;
 class CallExpr;
 class IDRValue;
 class NegatedRValue;
+class ArrayRValue;
+class SpawnRValue;
 
 
 class Visitor {
@@ -58,6 +62,7 @@ public:
   virtual void visit(IfStmt& node) = 0;
   virtual void visit(WhileStmt& node) = 0;
   virtual void visit(ForStmt& node) = 0;
+  virtual void visit(ParForStmt& node) = 0;
   // expressions
   virtual void visit(Expr& node) = 0;
   virtual void visit(SimpleTerm& node) = 0;
@@ -68,6 +73,8 @@ public:
   virtual void visit(CallExpr& node) = 0;
   virtual void visit(IDRValue& node) = 0;
   virtual void visit(NegatedRValue& node) = 0;
+  virtual void visit(ArrayRValue& node) = 0;
+  virtual void visit(SpawnRValue& node) = 0;
 };
 
 
@@ -93,6 +100,8 @@ class Decl : public ASTNode
 // root statement node
 class Stmt : public ASTNode
 {
+public:
+  int slot = -1;                // coverage counter (-1 if not counted)
 };
 
 
@@ -101,6 +110,8 @@ class ExprTerm : public ASTNode
 {
 public:
   virtual Token first_token() = 0;
+  // the expression of a complex term (nullptr for a simple term)
+  virtual Expr* term_expr() {return nullptr;}
 };
 
 // root rhs value node
@@ -123,8 +134,8 @@ public:
   ExprTerm* first = nullptr;    // the first term
   Token* op = nullptr;          // optional operator
   Expr* rest = nullptr;         // expression after operator (if exists)
-  // cleanup
-  ~Expr() {delete first; delete op; delete rest;}
+  // cleanup (see below)
+  ~Expr();
   // get first token
   Token first_token() {return first->first_token();}
   // visitor access
@@ -151,8 +162,14 @@ public:
   Expr* expr = nullptr;         // term is another expression
   // cleanup memory
   ~ComplexTerm() {delete expr;}
-  // return first token
-  Token first_token() {return expr->first->first_token();}  
+  // return first token (of the innermost expression on the left)
+  Token first_token() {
+    Expr* e = expr;
+    while (e->first->term_expr() != nullptr)
+      e = e->first->term_expr();
+    return e->first->first_token();
+  }
+  Expr* term_expr() {return expr;}
   // visitor access
   void accept(Visitor& v) {v.visit(*this);}
 };  
@@ -215,9 +232,10 @@ public:
 class Repl : public ASTNode
 {
 public:
+  std::list<Decl*> decls;                  // functions and types declared
   std::list<Stmt*> stmts;                  // function body 
   // cleanup memory
-  ~Repl() {for (Stmt* s : stmts) delete s;}
+  ~Repl() {for (Decl* d : decls) delete d; for (Stmt* s : stmts) delete s;}
   // visitor access
   void accept(Visitor& v) {v.visit(*this);}
 };
@@ -240,9 +258,10 @@ class AssignStmt : public Stmt
 {
 public:
   std::list<Token> lvalue_list; // lhs as one or more ids
+  std::list<Expr*> indices;     // optional array indexes (of the lhs path)
   Expr* expr = nullptr;         // rhs expression
   // cleanup memory
-  ~AssignStmt() {delete expr;}
+  ~AssignStmt() {for (Expr* e : indices) delete e; delete expr;}
   // visitor access
   void accept(Visitor& v) {v.visit(*this);}
 };
@@ -316,6 +335,15 @@ public:
 };  
 
 
+// a for loop whose iterations may run in parallel
+class ParForStmt : public ForStmt
+{
+public:
+  // visitor access
+  void accept(Visitor& v) {v.visit(*this);}
+};
+
+
 //----------------------------------------------------------------------
 // RValue nodes
 //----------------------------------------------------------------------
@@ -336,6 +364,11 @@ class NewRValue : public RValue
 {
 public:
   Token type_id;                // type name being instantiated
+  Expr* array_size = nullptr;   // number of elements (if an array of type_id)
+  Expr* vec_length = nullptr;   // number of elements (if a vec)
+  bool frame_local = false;     // true if the object never escapes its call
+  // cleanup memory
+  ~NewRValue() {delete array_size; delete vec_length;}
   // return first token
   Token first_token() {return type_id;}  
   // visitor access
@@ -361,6 +394,9 @@ class IDRValue : public RValue
 {
 public:
   std::list<Token> path;        // one or more ids (path expression)
+  std::list<Expr*> indices;     // optional array indexes (of the path)
+  // cleanup memory
+  ~IDRValue() {for (Expr* e : indices) delete e;}
   // return first token
   Token first_token() {return path.front();}  
   // visitor access
@@ -381,4 +417,72 @@ public:
 };  
 
 
+class ArrayRValue : public RValue
+{
+public:
+  Token bracket;                // opening bracket
+  std::list<Expr*> elements;    // array element values
+  // cleanup memory
+  ~ArrayRValue() {for (Expr* e : elements) delete e;}
+  // return first token
+  Token first_token() {return bracket;}
+  // visitor access
+  void accept(Visitor& v) {v.visit(*this);}
+};
+
+
+class SpawnRValue : public RValue
+{
+public:
+  Token spawn;                  // spawn keyword
+  CallExpr* call = nullptr;     // function call run as a task
+  // cleanup memory
+  ~SpawnRValue() {delete call;}
+  // return first token
+  Token first_token() {return spawn;}
+  // visitor access
+  void accept(Visitor& v) {v.visit(*this);}
+};
+
+
+//----------------------------------------------------------------------
+// Left-nested expressions
+//----------------------------------------------------------------------
+
+// The parser groups a run of operators to the left, so a + b + c + d
+// is ((a + b) + c) + d: each operator's first term is a complex term
+// holding the operators before it. Long runs nest as deep as they are
+// long, so the destructor and the visitors walk this left side of an
+// expression in a loop instead of recursing once per operator.
+
+// node, then the expression of its first term (if a complex term),
+// then that expression's, and so on (appended to spine)
+void left_spine(Expr& node, std::vector<Expr*>& spine)
+{
+  Expr* e = &node;
+  spine.push_back(e);
+  while ((e = e->first->term_expr()) != nullptr)
+    spine.push_back(e);
+}
+
+Expr::~Expr()
+{
+  delete op;
+  delete rest;
+  // unlink each expression on the left before deleting it
+  ExprTerm* term = first;
+  while (ComplexTerm* c = dynamic_cast<ComplexTerm*>(term)) {
+    Expr* e = c->expr;
+    c->expr = nullptr;
+    delete c;
+    if (e == nullptr)
+      return;
+    term = e->first;
+    e->first = nullptr;
+    delete e;
+  }
+  delete term;
+}
+
+
 #endif
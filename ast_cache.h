@@ -0,0 +1,848 @@
+//----------------------------------------------------------------------
+// NAME: Charles Walker
+// FILE: ast_cache.h
+// DATE: Spring 2021
+// DESC: On-disk cache of checked MyPL programs. After a program is
+//       parsed, type checked, and analyzed, its AST (including the
+//       escape analysis results) is written in a compact binary form
+//       to a cache directory, under a name derived from a hash of the
+//       source and the interpreter build. A later run of the same
+//       source maps the file into memory and rebuilds the AST from
+//       it, skipping the lexer, parser, and type checker. The file
+//       holds the full source, so only the same source (not just one
+//       with the same hash) loads it. Cache files are written to a
+//       temporary name and renamed, so a reader never sees a partial
+//       file, and a file that does not match its header (or is cut
+//       short) is ignored.
+//----------------------------------------------------------------------
+
+
+#ifndef AST_CACHE_H
+#define AST_CACHE_H
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "token.h"
+#include "ast.h"
+#include "lexer.h"
+#include "parser.h"
+#include "type_checker.h"
+#include "escape_analysis.h"
+
+
+class AstCache
+{
+public:
+
+  // the directory holding cached programs: $MYPL_CACHE_DIR, else
+  // $XDG_CACHE_HOME/mypl, else ~/.cache/mypl
+  static std::string directory();
+
+  // the cache file for the given source
+  static std::string file_name(const std::string& source);
+
+  // rebuild the checked program for the source from the cache;
+  // returns false if it is not cached (or the file is unusable)
+  static bool load(const std::string& source, Program& program);
+
+  // write the checked program for the source to the cache; returns
+  // false if the file could not be written
+  static bool store(const std::string& source, Program& program);
+
+  // lex, parse, type check, and analyze the source into program,
+  // unless use_cache is set and the cache already holds it (a newly
+  // checked program is then added to the cache)
+  static void compile(const std::string& source, Program& program, bool use_cache = true);
+
+private:
+
+  // changes whenever the file layout changes; the build stamp also
+  // invalidates files written by other builds of the interpreter
+  static const uint32_t FORMAT_VERSION = 4;
+  static const char* build_stamp();
+
+  // FNV-1a hash of the source and the build stamp (names the file)
+  static uint64_t hash(const std::string& source);
+
+  // create the directory (and its parents) if needed
+  static bool make_dirs(const std::string& path);
+
+  class Writer;
+  class Reader;
+};
+
+
+//----------------------------------------------------------------------
+// Serialization format
+//----------------------------------------------------------------------
+//
+// header: "MYPLAST" + '\0', format version (u32), build stamp (str),
+//         source (str)
+// body:   the program's declarations (u32 count + nodes)
+//
+// Each node starts with a tag byte; child lists are a u32 count
+// followed by the nodes, and optional children are a NONE tag. Each
+// statement in a list is preceded by its coverage slot + 1 (u32).
+// Strings are a u32 length followed by the characters, and tokens are
+// a type (u32), lexeme (str), line, and column (i32). Numbers are written in
+// the machine's byte order, since cache files are not shared.
+
+namespace ast_cache {
+  enum Tag : uint8_t {
+    NONE, FUN_DECL, TYPE_DECL, VAR_DECL, ASSIGN, RETURN, IF, WHILE, FOR,
+    PARFOR, CALL, EXPR, SIMPLE_TERM, COMPLEX_TERM, SIMPLE_RVALUE,
+    NEW_RVALUE, ID_RVALUE, NEGATED_RVALUE, ARRAY_RVALUE, SPAWN_RVALUE
+  };
+  const char MAGIC[8] = {'M', 'Y', 'P', 'L', 'A', 'S', 'T', '\0'};
+}
+
+
+class AstCache::Writer : public Visitor
+{
+public:
+
+  std::string bytes;
+
+  void u8(uint8_t val) {bytes.push_back((char)val);}
+  void u32(uint32_t val) {bytes.append((const char*)&val, sizeof(val));}
+  void str(const std::string& val) {u32(val.size()); bytes.append(val);}
+  void token(const Token& t);
+  void stmts(const std::list<Stmt*>& list);
+  void exprs(const std::list<Expr*>& list);
+  void expr(Expr* e);
+
+  // top-level
+  void visit(Program& node);
+  void visit(FunDecl& node);
+  void visit(TypeDecl& node);
+  void visit(Repl& node) {}               // repl input is not cached
+  // statements
+  void visit(ReplEndpoint& node) {}
+  void visit(VarDeclStmt& node);
+  void visit(AssignStmt& node);
+  void visit(ReturnStmt& node);
+  void visit(IfStmt& node);
+  void visit(WhileStmt& node);
+  void visit(ForStmt& node);
+  void visit(ParForStmt& node);
+  // expressions
+  void visit(Expr& node);
+  void visit(SimpleTerm& node);
+  void visit(ComplexTerm& node);
+  // rvalues
+  void visit(SimpleRValue& node);
+  void visit(NewRValue& node);
+  void visit(CallExpr& node);
+  void visit(IDRValue& node);
+  void visit(NegatedRValue& node);
+  void visit(ArrayRValue& node);
+  void visit(SpawnRValue& node);
+};
+
+
+class AstCache::Reader
+{
+public:
+
+  // thrown when the file does not hold a well-formed program
+  class Corrupt {};
+
+  Reader(const char* start, size_t size) : pos(start), end(start + size) {}
+
+  const char* pos;
+  const char* end;
+
+  const char* take(size_t n);
+  uint8_t u8() {return *(const uint8_t*)take(1);}
+  uint32_t u32() {uint32_t v; std::memcpy(&v, take(sizeof(v)), sizeof(v)); return v;}
+  std::string str() {uint32_t n = u32(); return std::string(take(n), n);}
+  Token token();
+
+  Decl* decl();
+  VarDeclStmt* var_decl();
+  Stmt* stmt();
+  void stmts(std::list<Stmt*>& list);
+  Expr* expr();
+  void exprs(std::list<Expr*>& list);
+  ExprTerm* term();
+  RValue* rvalue();
+  CallExpr* call();
+};
+
+
+//----------------------------------------------------------------------
+// Cache files
+//----------------------------------------------------------------------
+
+const char* AstCache::build_stamp()
+{
+  return __DATE__ " " __TIME__;
+}
+
+
+uint64_t AstCache::hash(const std::string& source)
+{
+  uint64_t h = 14695981039346656037ULL;
+  for (unsigned char c : source + '\0' + build_stamp()) {
+    h ^= c;
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+
+std::string AstCache::directory()
+{
+  const char* dir = std::getenv("MYPL_CACHE_DIR");
+  if (dir != nullptr && *dir != '\0')
+    return dir;
+  dir = std::getenv("XDG_CACHE_HOME");
+  if (dir != nullptr && *dir != '\0')
+    return std::string(dir) + "/mypl";
+  dir = std::getenv("HOME");
+  if (dir != nullptr && *dir != '\0')
+    return std::string(dir) + "/.cache/mypl";
+  return "";
+}
+
+
+std::string AstCache::file_name(const std::string& source)
+{
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.ast", (unsigned long long)hash(source));
+  return directory() + "/" + name;
+}
+
+
+bool AstCache::make_dirs(const std::string& path)
+{
+  for (size_t i = 1; i <= path.size(); ++i) {
+    if (i == path.size() || path[i] == '/') {
+      std::string prefix = path.substr(0, i);
+      if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST)
+        return false;
+    }
+  }
+  return true;
+}
+
+
+bool AstCache::load(const std::string& source, Program& program)
+{
+  if (directory() == "")
+    return false;
+  int fd = open(file_name(source).c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    close(fd);
+    return false;
+  }
+  size_t size = info.st_size;
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return false;
+  bool loaded = false;
+  Reader in((const char*)data, size);
+  try {
+    if (std::memcmp(in.take(8), ast_cache::MAGIC, 8) == 0 &&
+        in.u32() == FORMAT_VERSION && in.str() == build_stamp() &&
+        in.u32() == source.size() &&
+        std::memcmp(in.take(source.size()), source.data(), source.size()) == 0)
+    {
+      for (uint32_t n = in.u32(); n > 0; --n)
+        program.decls.push_back(in.decl());
+      loaded = in.pos == in.end;
+    }
+  }
+  catch (Reader::Corrupt&) {
+  }
+  munmap(data, size);
+  if (!loaded) {
+    for (Decl* d : program.decls)
+      delete d;
+    program.decls.clear();
+  }
+  return loaded;
+}
+
+
+bool AstCache::store(const std::string& source, Program& program)
+{
+  std::string dir = directory();
+  if (dir == "" || !make_dirs(dir))
+    return false;
+  Writer out;
+  out.bytes.append(ast_cache::MAGIC, 8);
+  out.u32(FORMAT_VERSION);
+  out.str(build_stamp());
+  out.str(source);
+  program.accept(out);
+  // write a temporary file, then move it into place (mkstemp gives
+  // each writer, including --batch threads, its own temporary file)
+  std::string name = file_name(source);
+  std::string tmp_name = name + ".tmpXXXXXX";
+  int fd = mkstemp(&tmp_name[0]);
+  if (fd < 0)
+    return false;
+  fchmod(fd, 0644);
+  FILE* file = fdopen(fd, "wb");
+  if (file == nullptr) {
+    close(fd);
+    std::remove(tmp_name.c_str());
+    return false;
+  }
+  bool written = std::fwrite(out.bytes.data(), 1, out.bytes.size(), file) == out.bytes.size();
+  written = std::fclose(file) == 0 && written;
+  if (!written || std::rename(tmp_name.c_str(), name.c_str()) != 0) {
+    std::remove(tmp_name.c_str());
+    return false;
+  }
+  return true;
+}
+
+
+void AstCache::compile(const std::string& source, Program& program, bool use_cache)
+{
+  if (use_cache && load(source, program))
+    return;
+  std::istringstream input(source);
+  Lexer lexer(input);
+  Parser parser(lexer);
+  parser.parse(program);
+  TypeChecker type_checker;
+  program.accept(type_checker);
+  EscapeAnalysis escape_analysis;
+  program.accept(escape_analysis);
+  if (use_cache)
+    store(source, program);
+}
+
+
+//----------------------------------------------------------------------
+// Writer
+//----------------------------------------------------------------------
+
+void AstCache::Writer::token(const Token& t)
+{
+  u32(t.type());
+  str(t.lexeme());
+  u32(t.line());
+  u32(t.column());
+}
+
+
+void AstCache::Writer::stmts(const std::list<Stmt*>& list)
+{
+  u32(list.size());
+  for (Stmt* s : list) {
+    u32(s->slot + 1);
+    s->accept(*this);
+  }
+}
+
+
+void AstCache::Writer::exprs(const std::list<Expr*>& list)
+{
+  u32(list.size());
+  for (Expr* e : list)
+    e->accept(*this);
+}
+
+
+void AstCache::Writer::expr(Expr* e)
+{
+  if (e == nullptr)
+    u8(ast_cache::NONE);
+  else
+    e->accept(*this);
+}
+
+
+void AstCache::Writer::visit(Program& node)
+{
+  u32(node.decls.size());
+  for (Decl* d : node.decls)
+    d->accept(*this);
+}
+
+
+void AstCache::Writer::visit(FunDecl& node)
+{
+  u8(ast_cache::FUN_DECL);
+  token(node.return_type);
+  token(node.id);
+  u32(node.params.size());
+  for (FunDecl::FunParam& p : node.params) {
+    token(p.id);
+    token(p.type);
+  }
+  stmts(node.stmts);
+}
+
+
+void AstCache::Writer::visit(TypeDecl& node)
+{
+  u8(ast_cache::TYPE_DECL);
+  token(node.id);
+  u32(node.vdecls.size());
+  for (VarDeclStmt* v : node.vdecls)
+    v->accept(*this);
+}
+
+
+void AstCache::Writer::visit(VarDeclStmt& node)
+{
+  u8(ast_cache::VAR_DECL);
+  u8(node.type != nullptr);
+  if (node.type)
+    token(*node.type);
+  token(node.id);
+  expr(node.expr);
+}
+
+
+void AstCache::Writer::visit(AssignStmt& node)
+{
+  u8(ast_cache::ASSIGN);
+  u32(node.lvalue_list.size());
+  for (Token& t : node.lvalue_list)
+    token(t);
+  exprs(node.indices);
+  expr(node.expr);
+}
+
+
+void AstCache::Writer::visit(ReturnStmt& node)
+{
+  u8(ast_cache::RETURN);
+  expr(node.expr);
+}
+
+
+void AstCache::Writer::visit(IfStmt& node)
+{
+  u8(ast_cache::IF);
+  expr(node.if_part->expr);
+  stmts(node.if_part->stmts);
+  u32(node.else_ifs.size());
+  for (BasicIf* b : node.else_ifs) {
+    expr(b->expr);
+    stmts(b->stmts);
+  }
+  stmts(node.body_stmts);
+}
+
+
+void AstCache::Writer::visit(WhileStmt& node)
+{
+  u8(ast_cache::WHILE);
+  expr(node.expr);
+  stmts(node.stmts);
+}
+
+
+void AstCache::Writer::visit(ForStmt& node)
+{
+  u8(ast_cache::FOR);
+  token(node.var_id);
+  expr(node.start);
+  expr(node.end);
+  stmts(node.stmts);
+}
+
+
+void AstCache::Writer::visit(ParForStmt& node)
+{
+  u8(ast_cache::PARFOR);
+  token(node.var_id);
+  expr(node.start);
+  expr(node.end);
+  stmts(node.stmts);
+}
+
+
+void AstCache::Writer::visit(Expr& node)
+{
+  // the expressions on the left (see left_spine) are written in a
+  // loop: each one's start and complex term, the innermost first
+  // term, then each one's operator and rest from the innermost out
+  std::vector<Expr*> spine;
+  left_spine(node, spine);
+  for (Expr* e : spine) {
+    u8(ast_cache::EXPR);
+    u8(e->negated);
+    if (e != spine.back())
+      u8(ast_cache::COMPLEX_TERM);
+  }
+  spine.back()->first->accept(*this);
+  for (auto e = spine.rbegin(); e != spine.rend(); ++e) {
+    u8((*e)->op != nullptr);
+    if ((*e)->op)
+      token(*(*e)->op);
+    expr((*e)->rest);
+  }
+}
+
+
+void AstCache::Writer::visit(SimpleTerm& node)
+{
+  u8(ast_cache::SIMPLE_TERM);
+  node.rvalue->accept(*this);
+}
+
+
+void AstCache::Writer::visit(ComplexTerm& node)
+{
+  u8(ast_cache::COMPLEX_TERM);
+  expr(node.expr);
+}
+
+
+void AstCache::Writer::visit(SimpleRValue& node)
+{
+  u8(ast_cache::SIMPLE_RVALUE);
+  token(node.value);
+}
+
+
+void AstCache::Writer::visit(NewRValue& node)
+{
+  u8(ast_cache::NEW_RVALUE);
+  token(node.type_id);
+  expr(node.array_size);
+  expr(node.vec_length);
+  u8(node.frame_local);
+}
+
+
+void AstCache::Writer::visit(CallExpr& node)
+{
+  u8(ast_cache::CALL);
+  token(node.function_id);
+  exprs(node.arg_list);
+}
+
+
+void AstCache::Writer::visit(IDRValue& node)
+{
+  u8(ast_cache::ID_RVALUE);
+  u32(node.path.size());
+  for (Token& t : node.path)
+    token(t);
+  exprs(node.indices);
+}
+
+
+void AstCache::Writer::visit(NegatedRValue& node)
+{
+  u8(ast_cache::NEGATED_RVALUE);
+  expr(node.expr);
+}
+
+
+void AstCache::Writer::visit(ArrayRValue& node)
+{
+  u8(ast_cache::ARRAY_RVALUE);
+  token(node.bracket);
+  exprs(node.elements);
+}
+
+
+void AstCache::Writer::visit(SpawnRValue& node)
+{
+  u8(ast_cache::SPAWN_RVALUE);
+  token(node.spawn);
+  node.call->accept(*this);
+}
+
+
+//----------------------------------------------------------------------
+// Reader
+//----------------------------------------------------------------------
+
+const char* AstCache::Reader::take(size_t n)
+{
+  if ((size_t)(end - pos) < n)
+    throw Corrupt();
+  const char* start = pos;
+  pos += n;
+  return start;
+}
+
+
+Token AstCache::Reader::token()
+{
+  TokenType type = (TokenType)u32();
+  std::string lexeme = str();
+  int line = (int)u32();
+  int column = (int)u32();
+  return Token(type, lexeme, line, column);
+}
+
+
+Decl* AstCache::Reader::decl()
+{
+  uint8_t tag = u8();
+  if (tag == ast_cache::FUN_DECL) {
+    FunDecl* f = new FunDecl();
+    try {
+      f->return_type = token();
+      f->id = token();
+      for (uint32_t n = u32(); n > 0; --n) {
+        FunDecl::FunParam p;
+        p.id = token();
+        p.type = token();
+        f->params.push_back(p);
+      }
+      stmts(f->stmts);
+    }
+    catch (Corrupt&) {
+      delete f;
+      throw;
+    }
+    return f;
+  }
+  if (tag == ast_cache::TYPE_DECL) {
+    TypeDecl* t = new TypeDecl();
+    try {
+      t->id = token();
+      for (uint32_t n = u32(); n > 0; --n)
+        t->vdecls.push_back(var_decl());
+    }
+    catch (Corrupt&) {
+      delete t;
+      throw;
+    }
+    return t;
+  }
+  throw Corrupt();
+}
+
+
+VarDeclStmt* AstCache::Reader::var_decl()
+{
+  VarDeclStmt* v = dynamic_cast<VarDeclStmt*>(stmt());
+  if (v == nullptr)
+    throw Corrupt();
+  return v;
+}
+
+
+void AstCache::Reader::stmts(std::list<Stmt*>& list)
+{
+  for (uint32_t n = u32(); n > 0; --n) {
+    int slot = (int)u32() - 1;
+    list.push_back(stmt());
+    list.back()->slot = slot;
+  }
+}
+
+
+void AstCache::Reader::exprs(std::list<Expr*>& list)
+{
+  for (uint32_t n = u32(); n > 0; --n) {
+    Expr* e = expr();
+    if (e == nullptr)
+      throw Corrupt();
+    list.push_back(e);
+  }
+}
+
+
+Stmt* AstCache::Reader::stmt()
+{
+  // partially read nodes are freed through their destructors
+  uint8_t tag = u8();
+  if (tag == ast_cache::VAR_DECL) {
+    std::unique_ptr<VarDeclStmt> v(new VarDeclStmt());
+    if (u8())
+      v->type = new Token(token());
+    v->id = token();
+    v->expr = expr();
+    return v.release();
+  }
+  if (tag == ast_cache::ASSIGN) {
+    std::unique_ptr<AssignStmt> a(new AssignStmt());
+    for (uint32_t n = u32(); n > 0; --n)
+      a->lvalue_list.push_back(token());
+    exprs(a->indices);
+    a->expr = expr();
+    return a.release();
+  }
+  if (tag == ast_cache::RETURN) {
+    std::unique_ptr<ReturnStmt> r(new ReturnStmt());
+    r->expr = expr();
+    return r.release();
+  }
+  if (tag == ast_cache::IF) {
+    std::unique_ptr<IfStmt> i(new IfStmt());
+    i->if_part = new BasicIf();
+    i->if_part->expr = expr();
+    stmts(i->if_part->stmts);
+    for (uint32_t n = u32(); n > 0; --n) {
+      BasicIf* b = new BasicIf();
+      i->else_ifs.push_back(b);
+      b->expr = expr();
+      stmts(b->stmts);
+    }
+    stmts(i->body_stmts);
+    return i.release();
+  }
+  if (tag == ast_cache::WHILE) {
+    std::unique_ptr<WhileStmt> w(new WhileStmt());
+    w->expr = expr();
+    stmts(w->stmts);
+    return w.release();
+  }
+  if (tag == ast_cache::FOR || tag == ast_cache::PARFOR) {
+    std::unique_ptr<ForStmt> f(tag == ast_cache::FOR ? new ForStmt() : new ParForStmt());
+    f->start = nullptr;
+    f->end = nullptr;
+    f->var_id = token();
+    f->start = expr();
+    f->end = expr();
+    stmts(f->stmts);
+    return f.release();
+  }
+  if (tag == ast_cache::CALL) {
+    pos -= 1;
+    return call();
+  }
+  throw Corrupt();
+}
+
+
+Expr* AstCache::Reader::expr()
+{
+  uint8_t tag = u8();
+  if (tag == ast_cache::NONE)
+    return nullptr;
+  if (tag != ast_cache::EXPR)
+    throw Corrupt();
+  // the expressions on the left (nested in complex first terms) are
+  // read in a loop, as the writer writes them, and linked once each
+  // one is complete
+  std::vector<std::unique_ptr<Expr>> spine;
+  while (true) {
+    spine.emplace_back(new Expr());
+    Expr* e = spine.back().get();
+    e->negated = u8();
+    if (u8() != ast_cache::COMPLEX_TERM) {
+      pos -= 1;
+      e->first = term();
+      break;
+    }
+    e->first = new ComplexTerm();
+    if (u8() != ast_cache::EXPR)
+      throw Corrupt();
+  }
+  for (size_t i = spine.size(); i > 0; --i) {
+    Expr* e = spine[i - 1].get();
+    if (u8())
+      e->op = new Token(token());
+    e->rest = expr();
+    if (i > 1)
+      static_cast<ComplexTerm*>(spine[i - 2]->first)->expr = spine[i - 1].release();
+  }
+  return spine[0].release();
+}
+
+
+ExprTerm* AstCache::Reader::term()
+{
+  uint8_t tag = u8();
+  if (tag == ast_cache::SIMPLE_TERM) {
+    std::unique_ptr<SimpleTerm> s(new SimpleTerm());
+    s->rvalue = rvalue();
+    return s.release();
+  }
+  if (tag == ast_cache::COMPLEX_TERM) {
+    std::unique_ptr<ComplexTerm> c(new ComplexTerm());
+    c->expr = expr();
+    if (c->expr == nullptr)
+      throw Corrupt();
+    return c.release();
+  }
+  throw Corrupt();
+}
+
+
+CallExpr* AstCache::Reader::call()
+{
+  if (u8() != ast_cache::CALL)
+    throw Corrupt();
+  std::unique_ptr<CallExpr> c(new CallExpr());
+  c->function_id = token();
+  exprs(c->arg_list);
+  return c.release();
+}
+
+
+RValue* AstCache::Reader::rvalue()
+{
+  uint8_t tag = u8();
+  if (tag == ast_cache::SIMPLE_RVALUE) {
+    SimpleRValue* s = new SimpleRValue();
+    std::unique_ptr<SimpleRValue> owner(s);
+    s->value = token();
+    return owner.release();
+  }
+  if (tag == ast_cache::NEW_RVALUE) {
+    std::unique_ptr<NewRValue> n(new NewRValue());
+    n->type_id = token();
+    n->array_size = expr();
+    n->vec_length = expr();
+    n->frame_local = u8();
+    return n.release();
+  }
+  if (tag == ast_cache::CALL) {
+    pos -= 1;
+    return call();
+  }
+  if (tag == ast_cache::ID_RVALUE) {
+    std::unique_ptr<IDRValue> v(new IDRValue());
+    for (uint32_t n = u32(); n > 0; --n)
+      v->path.push_back(token());
+    if (v->path.empty())
+      throw Corrupt();
+    exprs(v->indices);
+    return v.release();
+  }
+  if (tag == ast_cache::NEGATED_RVALUE) {
+    std::unique_ptr<NegatedRValue> n(new NegatedRValue());
+    n->expr = expr();
+    if (n->expr == nullptr)
+      throw Corrupt();
+    return n.release();
+  }
+  if (tag == ast_cache::ARRAY_RVALUE) {
+    std::unique_ptr<ArrayRValue> a(new ArrayRValue());
+    a->bracket = token();
+    exprs(a->elements);
+    return a.release();
+  }
+  if (tag == ast_cache::SPAWN_RVALUE) {
+    std::unique_ptr<SpawnRValue> s(new SpawnRValue());
+    s->spawn = token();
+    s->call = call();
+    return s.release();
+  }
+  throw Corrupt();
+}
+
+
+#endif
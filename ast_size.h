@@ -0,0 +1,342 @@
+//----------------------------------------------------------------------
+// NAME: Charles Walker
+// FILE: ast_size.h
+// DATE: Spring 2021
+// DESC: Measures the size of an AST (mypl --time-phases): the number
+//       of nodes, and the bytes they take up, i.e., the node objects,
+//       the cells of their lists, the tokens they own, and lexemes too
+//       long to be stored within their string. Allocator overhead is
+//       not included, so the bytes are a lower bound.
+//----------------------------------------------------------------------
+
+
+#ifndef AST_SIZE_H
+#define AST_SIZE_H
+
+#include <list>
+#include <string>
+#include <vector>
+#include "ast.h"
+
+
+class AstSize : public Visitor
+{
+public:
+
+  // the nodes visited and their bytes
+  size_t nodes = 0;
+  size_t bytes = 0;
+
+  // top-level
+  void visit(Program& node);
+  void visit(FunDecl& node);
+  void visit(TypeDecl& node);
+  void visit(Repl& node);
+  // statements
+  void visit(ReplEndpoint& node);
+  void visit(VarDeclStmt& node);
+  void visit(AssignStmt& node);
+  void visit(ReturnStmt& node);
+  void visit(IfStmt& node);
+  void visit(WhileStmt& node);
+  void visit(ForStmt& node);
+  void visit(ParForStmt& node);
+  // expressions
+  void visit(Expr& node);
+  void visit(SimpleTerm& node);
+  void visit(ComplexTerm& node);
+  // rvalues
+  void visit(SimpleRValue& node);
+  void visit(NewRValue& node);
+  void visit(CallExpr& node);
+  void visit(IDRValue& node);
+  void visit(NegatedRValue& node);
+  void visit(ArrayRValue& node);
+  void visit(SpawnRValue& node);
+
+private:
+
+  // count a node of the given size
+  void add_node(size_t size);
+
+  // count the bytes a token keeps outside of its node
+  void add_lexeme(const Token& token);
+
+  // the bytes of a list cell holding a T
+  template<typename T>
+  static size_t cell();
+
+  // count a list's cells and visit its nodes
+  template<typename T>
+  void add_list(const std::list<T*>& nodes);
+
+  // count the cells of a list of tokens (and their lexemes)
+  void add_tokens(const std::list<Token>& tokens);
+};
+
+
+void AstSize::add_node(size_t size)
+{
+  ++nodes;
+  bytes += size;
+}
+
+
+void AstSize::add_lexeme(const Token& token)
+{
+  // short strings are kept within the string object
+  size_t length = token.lexeme().size();
+  if (length > std::string().capacity())
+    bytes += length + 1;
+}
+
+
+template<typename T>
+size_t AstSize::cell()
+{
+  // the links to the previous and next cells, then the element
+  return 2 * sizeof(void*) + sizeof(T);
+}
+
+
+template<typename T>
+void AstSize::add_list(const std::list<T*>& nodes)
+{
+  for (T* node : nodes) {
+    bytes += cell<T*>();
+    node->accept(*this);
+  }
+}
+
+
+void AstSize::add_tokens(const std::list<Token>& tokens)
+{
+  for (const Token& token : tokens) {
+    bytes += cell<Token>();
+    add_lexeme(token);
+  }
+}
+
+
+//----------------------------------------------------------------------
+// Top-level nodes
+//----------------------------------------------------------------------
+
+void AstSize::visit(Program& node)
+{
+  add_node(sizeof(node));
+  add_list(node.decls);
+}
+
+
+void AstSize::visit(FunDecl& node)
+{
+  add_node(sizeof(node));
+  add_lexeme(node.return_type);
+  add_lexeme(node.id);
+  for (FunDecl::FunParam& param : node.params) {
+    bytes += cell<FunDecl::FunParam>();
+    add_lexeme(param.id);
+    add_lexeme(param.type);
+  }
+  add_list(node.stmts);
+}
+
+
+void AstSize::visit(TypeDecl& node)
+{
+  add_node(sizeof(node));
+  add_lexeme(node.id);
+  add_list(node.vdecls);
+}
+
+
+void AstSize::visit(Repl& node)
+{
+  add_node(sizeof(node));
+  add_list(node.decls);
+  add_list(node.stmts);
+}
+
+
+//----------------------------------------------------------------------
+// Statement nodes
+//----------------------------------------------------------------------
+
+void AstSize::visit(ReplEndpoint& node)
+{
+  add_node(sizeof(node));
+  if (node.expr)
+    node.expr->accept(*this);
+}
+
+
+void AstSize::visit(VarDeclStmt& node)
+{
+  add_node(sizeof(node));
+  if (node.type) {
+    bytes += sizeof(Token);
+    add_lexeme(*node.type);
+  }
+  add_lexeme(node.id);
+  node.expr->accept(*this);
+}
+
+
+void AstSize::visit(AssignStmt& node)
+{
+  add_node(sizeof(node));
+  add_tokens(node.lvalue_list);
+  for (Expr* e : node.indices)
+    e->accept(*this);
+  node.expr->accept(*this);
+}
+
+
+void AstSize::visit(ReturnStmt& node)
+{
+  add_node(sizeof(node));
+  node.expr->accept(*this);
+}
+
+
+void AstSize::visit(IfStmt& node)
+{
+  add_node(sizeof(node));
+  bytes += sizeof(BasicIf);
+  node.if_part->expr->accept(*this);
+  add_list(node.if_part->stmts);
+  for (BasicIf* else_if : node.else_ifs) {
+    bytes += cell<BasicIf*>() + sizeof(BasicIf);
+    else_if->expr->accept(*this);
+    add_list(else_if->stmts);
+  }
+  add_list(node.body_stmts);
+}
+
+
+void AstSize::visit(WhileStmt& node)
+{
+  add_node(sizeof(node));
+  node.expr->accept(*this);
+  add_list(node.stmts);
+}
+
+
+void AstSize::visit(ForStmt& node)
+{
+  add_node(sizeof(node));
+  add_lexeme(node.var_id);
+  node.start->accept(*this);
+  node.end->accept(*this);
+  add_list(node.stmts);
+}
+
+
+void AstSize::visit(ParForStmt& node)
+{
+  visit(static_cast<ForStmt&>(node));
+}
+
+
+//----------------------------------------------------------------------
+// Expression nodes
+//----------------------------------------------------------------------
+
+void AstSize::visit(Expr& node)
+{
+  // the expressions on the left, and the complex terms holding them,
+  // are counted in a loop (see left_spine)
+  std::vector<Expr*> spine;
+  left_spine(node, spine);
+  for (Expr* e : spine) {
+    add_node(sizeof(*e));
+    if (e != &node)
+      add_node(sizeof(ComplexTerm));
+    if (e->op) {
+      bytes += sizeof(Token);
+      add_lexeme(*e->op);
+      e->rest->accept(*this);
+    }
+  }
+  spine.back()->first->accept(*this);
+}
+
+
+void AstSize::visit(SimpleTerm& node)
+{
+  add_node(sizeof(node));
+  node.rvalue->accept(*this);
+}
+
+
+void AstSize::visit(ComplexTerm& node)
+{
+  add_node(sizeof(node));
+  node.expr->accept(*this);
+}
+
+
+//----------------------------------------------------------------------
+// RValue nodes
+//----------------------------------------------------------------------
+
+void AstSize::visit(SimpleRValue& node)
+{
+  add_node(sizeof(node));
+  add_lexeme(node.value);
+}
+
+
+void AstSize::visit(NewRValue& node)
+{
+  add_node(sizeof(node));
+  add_lexeme(node.type_id);
+  if (node.array_size)
+    node.array_size->accept(*this);
+  if (node.vec_length)
+    node.vec_length->accept(*this);
+}
+
+
+void AstSize::visit(CallExpr& node)
+{
+  add_node(sizeof(node));
+  add_lexeme(node.function_id);
+  add_list(node.arg_list);
+}
+
+
+void AstSize::visit(IDRValue& node)
+{
+  add_node(sizeof(node));
+  add_tokens(node.path);
+  for (Expr* e : node.indices)
+    e->accept(*this);
+}
+
+
+void AstSize::visit(NegatedRValue& node)
+{
+  add_node(sizeof(node));
+  node.expr->accept(*this);
+}
+
+
+void AstSize::visit(ArrayRValue& node)
+{
+  add_node(sizeof(node));
+  add_lexeme(node.bracket);
+  add_list(node.elements);
+}
+
+
+void AstSize::visit(SpawnRValue& node)
+{
+  add_node(sizeof(node));
+  add_lexeme(node.spawn);
+  node.call->accept(*this);
+}
+
+
+#endif
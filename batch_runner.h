@@ -0,0 +1,132 @@
+//----------------------------------------------------------------------
+// NAME: Charles Walker
+// FILE: batch_runner.h
+// DATE: Spring 2021
+// DESC: Runs many MyPL programs in one process (mypl --batch). The
+//       scripts are spread over a thread pool, and each one gets its
+//       own lexer, parser, type checker, and interpreter (and so its
+//       own symbol table and heap). A script's output is buffered and
+//       read from an empty input, so scripts never see each other.
+//----------------------------------------------------------------------
+
+
+#ifndef BATCH_RUNNER_H
+#define BATCH_RUNNER_H
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "mypl_exception.h"
+#include "lexer.h"
+#include "parser.h"
+#include "ast.h"
+#include "type_checker.h"
+#include "escape_analysis.h"
+#include "interpreter.h"
+#include "thread_pool.h"
+#include "ast_cache.h"
+
+
+class BatchRunner
+{
+public:
+
+  // how scripts are run
+  struct Options {
+    bool use_cache = true;      // use the compiled-program cache
+    long long max_steps = 0;    // step limit per script (0 for none)
+    size_t max_heap = 0;        // heap cell limit per script (0 for none)
+  };
+
+  // the outcome of running one script
+  struct Result {
+    std::string path;
+    std::string output;         // what the script printed (and its error)
+    int exit_code = 0;          // main's return value, or 1 on an error
+  };
+
+  // run the scripts on the given number of threads (the results are
+  // in the same order as the paths)
+  static std::vector<Result> run(const std::vector<std::string>& paths, size_t threads,
+                                 const Options& options);
+
+  // run one script
+  static Result run_script(const std::string& path, const Options& options);
+
+  // read the script paths from a list file (one per line, blank
+  // lines skipped)
+  static bool read_list(const std::string& list_path, std::vector<std::string>& paths);
+};
+
+
+std::vector<BatchRunner::Result> BatchRunner::run(const std::vector<std::string>& paths, size_t threads,
+                                                  const Options& options)
+{
+  std::vector<Result> results(paths.size());
+  if (paths.empty())
+    return results;
+  // one script per job, so long scripts do not hold up the others
+  ThreadPool pool(threads);
+  pool.run(0, (int)paths.size() - 1, 1, [&](int first, int last) {
+    for (int i = first; i <= last; ++i)
+      results[i] = run_script(paths[i], options);
+  });
+  return results;
+}
+
+
+BatchRunner::Result BatchRunner::run_script(const std::string& path, const Options& options)
+{
+  Result result;
+  result.path = path;
+  std::ifstream file(path);
+  if (!file) {
+    result.output = "cannot open " + path + "\n";
+    result.exit_code = 1;
+    return result;
+  }
+  std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  std::ostringstream out;
+  std::istringstream in;
+  // the program outlives the interpreter, whose unjoined tasks may
+  // still be running it
+  Program ast_root_node;
+  Interpreter interpreter(out, in);
+  interpreter.set_max_steps(options.max_steps);
+  interpreter.set_max_heap(options.max_heap);
+  try {
+    AstCache::compile(source, ast_root_node, options.use_cache);
+    ast_root_node.accept(interpreter);
+    result.exit_code = interpreter.return_code();
+  } catch (MyPLException e) {
+    out << e.to_string() << "\n";
+    result.exit_code = 1;
+  }
+  // (after an error, tasks may still be writing to out)
+  interpreter.finish_tasks();
+  result.output = out.str();
+  return result;
+}
+
+
+bool BatchRunner::read_list(const std::string& list_path, std::vector<std::string>& paths)
+{
+  std::ifstream list(list_path);
+  if (!list)
+    return false;
+  std::string line;
+  while (std::getline(list, line)) {
+    // trim surrounding whitespace (and a carriage return)
+    size_t start = line.find_first_not_of(" \t\r");
+    if (start == std::string::npos)
+      continue;
+    size_t end = line.find_last_not_of(" \t\r");
+    paths.push_back(line.substr(start, end - start + 1));
+  }
+  return true;
+}
+
+
+#endif
@@ -0,0 +1,217 @@
+//----------------------------------------------------------------------
+// NAME: Charles Walker
+// FILE: bench.h
+// DATE: Spring 2021
+// DESC: A small microbenchmark harness (no dependencies) for
+//       mypl_bench. Each benchmark is a function called in batches:
+//       the batch size is doubled until a batch takes at least a
+//       minimum time, then warmup batches are run and thrown away,
+//       and then the time per call of each timed batch is recorded.
+//       Results give the median, 95th percentile, min, and mean time
+//       per call, and instructions per call when hardware counters
+//       are available (see perf_counters.h), as a table or as JSON.
+//----------------------------------------------------------------------
+
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "../perf_counters.h"
+
+
+class Bench
+{
+public:
+
+  struct Options {
+    int warmup = 3;             // batches run before timing
+    int reps = 15;              // timed batches
+    double min_batch_ms = 5;    // the least time a batch takes
+    std::string filter;         // run only names containing this
+  };
+
+  struct Result {
+    std::string name;
+    size_t batch;               // calls per batch
+    int reps;
+    double median_ns;           // per call
+    double p95_ns;
+    double min_ns;
+    double mean_ns;
+    double instructions;        // per call (-1 if not counted)
+  };
+
+  Bench(const Options& options);
+
+  // true if the named benchmark would run (with the filter)
+  bool selected(const std::string& name) const;
+
+  // time calls of fun (if selected), printing a line as it finishes
+  template<typename F>
+  void run(const std::string& name, F fun, std::ostream& progress);
+
+  // keep the compiler from dropping the computation of a value
+  template<typename T>
+  static void keep(const T& value);
+
+  // the results so far
+  const std::vector<Result>& results() const;
+
+  // write the results as JSON (with the harness's settings)
+  void write_json(std::ostream& out) const;
+
+  // write one result as a table row (header first)
+  static void header(std::ostream& out);
+  static void row(std::ostream& out, const Result& result);
+
+private:
+
+  Options options;
+  PerfCounters counters;
+  std::vector<Result> all;
+
+  // the time of a batch of calls in ns
+  template<typename F>
+  static double time_batch(F& fun, size_t batch);
+};
+
+
+Bench::Bench(const Options& options)
+  : options(options)
+{
+}
+
+
+bool Bench::selected(const std::string& name) const
+{
+  return name.find(options.filter) != std::string::npos;
+}
+
+
+template<typename T>
+void Bench::keep(const T& value)
+{
+#if defined(__GNUC__)
+  asm volatile("" : : "g"(&value) : "memory");
+#else
+  static const void* volatile sink;
+  sink = &value;
+#endif
+}
+
+
+template<typename F>
+double Bench::time_batch(F& fun, size_t batch)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < batch; ++i)
+    fun();
+  return std::chrono::duration<double, std::nano>(
+    std::chrono::steady_clock::now() - start).count();
+}
+
+
+template<typename F>
+void Bench::run(const std::string& name, F fun, std::ostream& progress)
+{
+  if (!selected(name))
+    return;
+  // the batch size (calibrating also warms up)
+  size_t batch = 1;
+  while (time_batch(fun, batch) < options.min_batch_ms * 1e6 && batch < ((size_t)1 << 30))
+    batch *= 2;
+  for (int i = 0; i < options.warmup; ++i)
+    time_batch(fun, batch);
+  int reps = std::max(options.reps, 1);
+  std::vector<double> times;
+  PerfCounters::Reading start = counters.read();
+  for (int i = 0; i < reps; ++i)
+    times.push_back(time_batch(fun, batch) / batch);
+  PerfCounters::Reading counts = counters.read() - start;
+  std::sort(times.begin(), times.end());
+  Result result;
+  result.name = name;
+  result.batch = batch;
+  result.reps = reps;
+  result.median_ns = reps % 2 == 1 ? times[reps / 2]
+                                   : (times[reps / 2 - 1] + times[reps / 2]) / 2;
+  // nearest rank
+  result.p95_ns = times[(size_t)std::ceil(0.95 * reps) - 1];
+  result.min_ns = times.front();
+  result.mean_ns = 0;
+  for (double t : times)
+    result.mean_ns += t / reps;
+  result.instructions = -1;
+  if (counts.valid[PerfCounters::INSTRUCTIONS])
+    result.instructions = counts.count[PerfCounters::INSTRUCTIONS] / ((double)batch * reps);
+  all.push_back(result);
+  row(progress, result);
+}
+
+
+const std::vector<Bench::Result>& Bench::results() const
+{
+  return all;
+}
+
+
+void Bench::header(std::ostream& out)
+{
+  out << std::left << std::setw(40) << "benchmark" << std::right
+      << std::setw(14) << "median ns" << std::setw(14) << "p95 ns"
+      << std::setw(14) << "min ns" << std::setw(10) << "batch"
+      << std::setw(14) << "instr/call" << "\n";
+}
+
+
+void Bench::row(std::ostream& out, const Result& result)
+{
+  out << std::left << std::setw(40) << result.name << std::right << std::fixed
+      << std::setprecision(1) << std::setw(14) << result.median_ns
+      << std::setw(14) << result.p95_ns << std::setw(14) << result.min_ns
+      << std::setw(10) << result.batch << std::setw(14);
+  if (result.instructions >= 0)
+    out << result.instructions;
+  else
+    out << "n/a";
+  out << "\n";
+  out.unsetf(std::ios::fixed);
+}
+
+
+void Bench::write_json(std::ostream& out) const
+{
+  char buf[256];
+  snprintf(buf, sizeof(buf), "{\"warmup\":%d,\"reps\":%d,\"min_batch_ms\":%g,",
+           options.warmup, options.reps, options.min_batch_ms);
+  out << buf << "\"counters\":" << (counters.available() ? "true" : "false")
+      << ",\"benchmarks\":[\n";
+  for (size_t i = 0; i < all.size(); ++i) {
+    const Result& r = all[i];
+    // names are file names and identifiers, so need no escaping
+    out << "{\"name\":\"" << r.name << "\",";
+    snprintf(buf, sizeof(buf), "\"batch\":%zu,\"reps\":%d,\"median_ns\":%.3f,"
+             "\"p95_ns\":%.3f,\"min_ns\":%.3f,\"mean_ns\":%.3f,",
+             r.batch, r.reps, r.median_ns, r.p95_ns, r.min_ns, r.mean_ns);
+    out << buf << "\"instructions\":";
+    if (r.instructions >= 0) {
+      snprintf(buf, sizeof(buf), "%.1f", r.instructions);
+      out << buf;
+    }
+    else
+      out << "null";
+    out << "}" << (i + 1 < all.size() ? ",\n" : "\n");
+  }
+  out << "]}\n";
+}
+
+
+#endif
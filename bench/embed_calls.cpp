@@ -0,0 +1,82 @@
+//----------------------------------------------------------------------
+// NAME: Charles Walker
+// FILE: embed_calls.cpp
+// DATE: Spring 2021
+// DESC: Per-call overhead of the libmypl host API: compiles a small
+//       rules program once and calls its functions many times, and
+//       compares that with compiling the program for every call.
+//
+//       usage: embed_calls [calls]
+//----------------------------------------------------------------------
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include "../mypl.h"
+
+using namespace std;
+
+
+const char* RULES = R"(
+fun int identity(x: int)
+  return x
+end
+
+fun int discount(total: int, member: bool)
+  var pct = 0
+  if total > 1000 then
+    pct = 10
+  elseif total > 100 then
+    pct = 5
+  end
+  if member then
+    pct = pct + 5
+  end
+  return (total * (100 - pct)) / 100
+end
+
+fun string label(total: int)
+  if total > 1000 then
+    return "large"
+  end
+  return "small"
+end
+)";
+
+
+// seconds per call of f over n calls
+template<typename F>
+double per_call(int n, F f)
+{
+  auto start = chrono::steady_clock::now();
+  for (int i = 0; i < n; ++i)
+    f(i);
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count() / n;
+}
+
+
+int main(int argc, char* argv[])
+{
+  int n = argc > 1 ? atoi(argv[1]) : 1000000;
+  MyPLProgram program(RULES);
+  long long sum = 0;
+  double identity = per_call(n, [&](int i) {
+    sum += program.call("identity", {i}).as_int();
+  });
+  double discount = per_call(n, [&](int i) {
+    sum += program.call("discount", {i % 2000, i % 3 == 0}).as_int();
+  });
+  double label = per_call(n, [&](int i) {
+    sum += program.call("label", {i % 2000}).as_string().size();
+  });
+  int m = n / 100 > 0 ? n / 100 : 1;
+  double recompile = per_call(m, [&](int i) {
+    MyPLProgram fresh(RULES);
+    sum += fresh.call("discount", {i % 2000, i % 3 == 0}).as_int();
+  });
+  cout << "identity:            " << identity * 1e9 << " ns/call\n"
+       << "discount:            " << discount * 1e9 << " ns/call\n"
+       << "label:               " << label * 1e9 << " ns/call\n"
+       << "compile + discount:  " << recompile * 1e9 << " ns/call\n"
+       << "(checksum " << sum << ")\n";
+}
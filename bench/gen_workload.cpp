@@ -0,0 +1,268 @@
+//----------------------------------------------------------------------
+// NAME: Charles Walker
+// FILE: gen_workload.cpp
+// DATE: Spring 2021
+// DESC: Generates synthetic, type-correct MyPL programs for scaling
+//       studies of the front end and interpreter (see scaling.sh).
+//       The program's shape is tunable: the number of functions, the
+//       nesting depth of if and for statements, the statements per
+//       block, the terms per expression, the number of user-defined
+//       types and their fields, the trip count of each loop, and the
+//       depth of a recursive function. With --size the number of
+//       functions is instead chosen to reach (about) that many bytes
+//       of source. Output is the same for the same options and seed.
+//
+//       Each function runs its body once: f_k calls f_(k-1) except at
+//       the start of each group of 64 functions, and main calls the
+//       last function of each group, so calls nest at most 64 deep.
+//       Values are kept small (% 1000 on every assignment), so ints
+//       never overflow. The run time grows with the functions, the
+//       statements per block, and trips^depth.
+//
+//       usage: gen_workload [--functions N] [--size BYTES]
+//                [--depth D] [--stmts S] [--expr-len L] [--types T]
+//                [--fields F] [--trips K] [--recursion R] [--seed X]
+//----------------------------------------------------------------------
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+
+struct Shape
+{
+  long long functions = 10;
+  long long size = 0;           // bytes of source (0 to use functions)
+  int depth = 2;                // nesting of if and for statements
+  int stmts = 4;                // statements per block
+  int expr_len = 4;             // terms per expression
+  int types = 2;                // user-defined types
+  int fields = 3;               // fields per type
+  int trips = 10;               // iterations of each for loop
+  int recursion = 10;           // depth of the recursive function
+  unsigned seed = 1;
+};
+
+
+// calls nest at most this deep (see DESC)
+const long long GROUP = 64;
+
+// the local variables of every function
+const int LOCALS = 3;
+
+
+class Generator
+{
+public:
+
+  Generator(const Shape& shape) : shape(shape), random(shape.seed) {}
+
+  // the type declarations and the recursive function
+  void header(ostream& out);
+
+  // function k
+  void function(ostream& out, long long k);
+
+  // main, calling the functions 0 to count - 1
+  void main_function(ostream& out, long long count);
+
+private:
+
+  const Shape& shape;
+  mt19937 random;
+
+  // the for loops enclosing the current statement
+  int loops = 0;
+
+  // a number from 0 to n - 1
+  int pick(int n) {return uniform_int_distribution<int>(0, n - 1)(random);}
+
+  void indent(ostream& out, int level) {out << string(2 * level, ' ');}
+
+  // a term: a constant, variable, parameter, loop variable, or field
+  string term();
+
+  // an int expression of expr_len terms
+  string expr();
+
+  // a bool expression comparing two int expressions
+  string condition();
+
+  // a block of statements nested depth more levels
+  void block(ostream& out, int level, int depth);
+};
+
+
+string Generator::term()
+{
+  switch (pick(5)) {
+    case 0: return to_string(pick(100));
+    case 1: return pick(2) ? "a" : "b";
+    case 2:
+      if (loops > 0)
+        return "i" + to_string(pick(loops));
+      break;
+    case 3:
+      if (shape.types > 0 && shape.fields > 0)
+        return "t.f" + to_string(pick(shape.fields));
+      break;
+  }
+  return "v" + to_string(pick(LOCALS));
+}
+
+
+string Generator::expr()
+{
+  // + and -, with the last term sometimes times 3 (* binds tighter,
+  // so only that term is multiplied and the value stays small)
+  string e = term();
+  for (int i = 1; i < shape.expr_len; ++i) {
+    e += pick(2) ? " + " : " - ";
+    e += term();
+  }
+  if (pick(4) == 0)
+    e += " * 3";
+  return e;
+}
+
+
+string Generator::condition()
+{
+  static const char* OPS[] = {"<", "<=", ">", ">=", "==", "!="};
+  return "(" + expr() + ") " + OPS[pick(6)] + " (" + expr() + ")";
+}
+
+
+void Generator::block(ostream& out, int level, int depth)
+{
+  for (int s = 0; s < shape.stmts; ++s) {
+    int kind = pick(depth > 0 ? 4 : 2);
+    if (kind == 0 || (kind == 1 && (shape.types == 0 || shape.fields == 0))) {
+      indent(out, level);
+      out << "v" << pick(LOCALS) << " = (" << expr() << ") % 1000\n";
+    }
+    else if (kind == 1) {
+      indent(out, level);
+      out << "t.f" << pick(shape.fields) << " = (" << expr() << ") % 1000\n";
+    }
+    else if (kind == 2) {
+      indent(out, level);
+      out << "if " << condition() << " then\n";
+      block(out, level + 1, depth - 1);
+      indent(out, level);
+      out << "else\n";
+      block(out, level + 1, depth - 1);
+      indent(out, level);
+      out << "end\n";
+    }
+    else {
+      indent(out, level);
+      out << "for i" << loops << " = 1 to " << shape.trips << " do\n";
+      ++loops;
+      block(out, level + 1, depth - 1);
+      --loops;
+      indent(out, level);
+      out << "end\n";
+    }
+  }
+}
+
+
+void Generator::header(ostream& out)
+{
+  out << "# generated by gen_workload (seed " << shape.seed << ")\n\n";
+  for (int t = 0; t < shape.types; ++t) {
+    out << "type T" << t << "\n";
+    for (int f = 0; f < shape.fields; ++f)
+      out << "  var f" << f << " = " << f << "\n";
+    out << "end\n\n";
+  }
+  out << "fun int rec(n: int)\n"
+      << "  if n <= 0 then\n"
+      << "    return 0\n"
+      << "  end\n"
+      << "  return (rec(n - 1) + n) % 1000\n"
+      << "end\n\n";
+}
+
+
+void Generator::function(ostream& out, long long k)
+{
+  out << "fun int f" << k << "(a: int, b: int)\n";
+  for (int v = 0; v < LOCALS; ++v)
+    out << "  var v" << v << " = " << (v == 0 ? "a" : v == 1 ? "b" : "0") << "\n";
+  if (shape.types > 0)
+    out << "  var t = new T" << k % shape.types << "\n";
+  if (k % GROUP != 0)
+    out << "  v2 = f" << k - 1 << "(b, a) % 1000\n";
+  block(out, 1, shape.depth);
+  out << "  return (v0 + v1 + v2) % 1000\n"
+      << "end\n\n";
+}
+
+
+void Generator::main_function(ostream& out, long long count)
+{
+  out << "fun int main()\n"
+      << "  var r = rec(" << shape.recursion << ")\n";
+  for (long long k = 0; k < count; ++k)
+    if (k % GROUP == GROUP - 1 || k == count - 1)
+      out << "  r = (r + f" << k << "(r, " << k % 100 << ")) % 1000\n";
+  out << "  print(itos(r) + \"\\n\")\n"
+      << "end\n";
+}
+
+
+int main(int argc, char* argv[])
+{
+  Shape shape;
+  for (int i = 1; i < argc; ++i) {
+    const char* opt = argv[i];
+    if (i + 1 >= argc || strncmp(opt, "--", 2) != 0) {
+      cerr << "bad option " << opt << endl;
+      return 1;
+    }
+    long long val = atoll(argv[++i]);
+    if (strcmp(opt, "--functions") == 0) shape.functions = val;
+    else if (strcmp(opt, "--size") == 0) shape.size = val;
+    else if (strcmp(opt, "--depth") == 0) shape.depth = val;
+    else if (strcmp(opt, "--stmts") == 0) shape.stmts = val;
+    else if (strcmp(opt, "--expr-len") == 0) shape.expr_len = val;
+    else if (strcmp(opt, "--types") == 0) shape.types = val;
+    else if (strcmp(opt, "--fields") == 0) shape.fields = val;
+    else if (strcmp(opt, "--trips") == 0) shape.trips = val;
+    else if (strcmp(opt, "--recursion") == 0) shape.recursion = val;
+    else if (strcmp(opt, "--seed") == 0) shape.seed = val;
+    else {
+      cerr << "unknown option " << opt << endl;
+      return 1;
+    }
+  }
+  if (shape.functions < 1 || shape.depth < 0 || shape.stmts < 1 || shape.expr_len < 1 ||
+      shape.types < 0 || shape.fields < 0 || shape.trips < 0 || shape.recursion < 0) {
+    cerr << "functions, stmts, and expr-len must be positive, the rest not negative" << endl;
+    return 1;
+  }
+  ios::sync_with_stdio(false);
+  Generator generator(shape);
+  ostringstream part;
+  generator.header(part);
+  long long bytes = part.str().size();
+  cout << part.str();
+  long long count = 0;
+  // with --size, add functions until the size is reached (main adds
+  // a line per GROUP functions)
+  while (shape.size > 0 ? bytes < shape.size : count < shape.functions) {
+    part.str("");
+    generator.function(part, count++);
+    bytes += part.str().size();
+    cout << part.str();
+  }
+  generator.main_function(cout, count);
+  return 0;
+}
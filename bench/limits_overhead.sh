@@ -0,0 +1,32 @@
+#!/bin/bash
+#----------------------------------------------------------------------
+# Overhead of the step and heap limits: runs bench/fuel_loop.mypl R
+# times (default 5) each with no limits and with limits far above what
+# it uses, and prints the best time of each.
+#
+# usage: bench/limits_overhead.sh [mypl binary] [R]
+#----------------------------------------------------------------------
+
+MYPL=${1:-./mypl}
+R=${2:-5}
+SCRIPT=$(dirname "$0")/fuel_loop.mypl
+
+# time of one run of mypl with the given options, in ms
+run() {
+  local start=$(date +%s%N)
+  "$MYPL" "$@" "$SCRIPT" > /dev/null || exit 1
+  echo $(( ($(date +%s%N) - start) / 1000000 ))
+}
+
+# the runs are interleaved so that load changes hit both alike
+NONE=
+LIMITS=
+for ((r = 0; r < R; r++)); do
+  T=$(run --no-cache)
+  [[ -z $NONE || $T -lt $NONE ]] && NONE=$T
+  T=$(run --no-cache --max-steps 1000000000 --max-heap 100000000)
+  [[ -z $LIMITS || $T -lt $LIMITS ]] && LIMITS=$T
+done
+awk -v none="$NONE" -v limits="$LIMITS" 'BEGIN {
+  printf "no limits: %d ms\nlimits:    %d ms (%+.1f%%)\n", none, limits, (limits - none) * 100 / none
+}'
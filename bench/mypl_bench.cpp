@@ -0,0 +1,301 @@
+//----------------------------------------------------------------------
+// NAME: Charles Walker
+// FILE: mypl_bench.cpp
+// DATE: Spring 2021
+// DESC: The MyPL benchmark suite (see bench.h). For each program in
+//       the tests directory it times lexing (Lexer::next_token until
+//       the end), parsing (Parser::parse, which lexes as it goes),
+//       type checking (TypeChecker on the parsed program), and
+//       running it end to end on a fresh Interpreter (with output to
+//       a string and "hello" as input), also with line coverage
+//       counted (coverage.h). The same is done for generated programs
+//       with long and/or conditions and long sums. Microbenchmarks
+//       then time DataObject, SymbolTable, and Heap operations. The
+//       mypl_bench CMake target is built with -O2.
+//
+//       usage: mypl_bench [--json FILE] [--filter TEXT] [--reps N]
+//                         [--warmup N] [--min-batch-ms MS] [tests-dir]
+//----------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include "../token.h"
+#include "../mypl_exception.h"
+#include "../lexer.h"
+#include "../parser.h"
+#include "../ast.h"
+#include "../type_checker.h"
+#include "../escape_analysis.h"
+#include "../interpreter.h"
+#include "bench.h"
+
+using namespace std;
+
+
+// the MyPL programs (*.mypl) in a directory, by name
+vector<string> programs(const string& dir)
+{
+  vector<string> names;
+  DIR* d = opendir(dir.c_str());
+  if (d == nullptr)
+    return names;
+  while (struct dirent* entry = readdir(d)) {
+    string name = entry->d_name;
+    if (name.size() > 5 && name.compare(name.size() - 5, 5, ".mypl") == 0)
+      names.push_back(name);
+  }
+  closedir(d);
+  sort(names.begin(), names.end());
+  return names;
+}
+
+
+// run the program end to end on fresh interpreters with the policy
+// (false if it stopped with an error)
+template<typename Policy>
+bool run_interpreter(Bench& bench, const string& name, Program& program)
+{
+  bool ran = true;
+  bench.run(name, [&]() {
+    ostringstream out;
+    istringstream in("hello\n");
+    BasicInterpreter<Policy> interpreter(out, in);
+    try {
+      program.accept(interpreter);
+    } catch (MyPLException& e) {
+      ran = false;
+    }
+    Bench::keep(interpreter);
+  }, cout);
+  return ran;
+}
+
+
+// the front-end and end-to-end benchmarks of one program
+void bench_program(Bench& bench, const string& name, const string& source)
+{
+  bench.run("lex/" + name, [&]() {
+    istringstream input(source);
+    Lexer lexer(input);
+    size_t tokens = 0;
+    while (lexer.next_token().type() != EOS)
+      ++tokens;
+    Bench::keep(tokens);
+  }, cout);
+  bench.run("parse/" + name, [&]() {
+    istringstream input(source);
+    Lexer lexer(input);
+    Parser parser(lexer);
+    Program program;
+    parser.parse(program);
+    Bench::keep(program);
+  }, cout);
+  // the later phases reuse one checked program
+  Program program;
+  try {
+    istringstream input(source);
+    Lexer lexer(input);
+    Parser parser(lexer);
+    parser.parse(program);
+    TypeChecker type_checker;
+    program.accept(type_checker);
+    EscapeAnalysis escape_analysis;
+    program.accept(escape_analysis);
+  } catch (MyPLException& e) {
+    cerr << name << ": " << e.to_string() << endl;
+    return;
+  }
+  bench.run("typecheck/" + name, [&]() {
+    TypeChecker type_checker;
+    program.accept(type_checker);
+    Bench::keep(type_checker);
+  }, cout);
+  bool ran = run_interpreter<NoInstrumentation>(bench, "interpret/" + name, program);
+  // the cost of counting line coverage
+  run_interpreter<Covered>(bench, "coverage/" + name, program);
+  if (!ran)
+    cerr << name << ": runtime error (the interpret time is of a partial run)" << endl;
+}
+
+
+// a program testing a condition of n comparisons joined by op ten
+// times: joined by and every comparison is true, so all of them are
+// evaluated, and joined by or the first one is, so the rest are skipped
+string condition_program(int n, const string& op)
+{
+  ostringstream source;
+  source << "fun int main()\n"
+         << "  var hits = 0\n"
+         << "  for i = 1 to 10 do\n"
+         << "    if i > 0";
+  for (int k = 1; k < n; ++k)
+    source << " " << op << (op == "and" ? " i < " : " i > ") << 11 + k % 100;
+  source << " then\n"
+         << "      hits = hits + 1\n"
+         << "    end\n"
+         << "  end\n"
+         << "  return hits\n"
+         << "end\n";
+  return source.str();
+}
+
+
+// a program adding up n terms in one expression ten times (a + b + c
+// ... nests n deep, so this also tests that none of the phases
+// recurse once per operator)
+string sum_program(int n)
+{
+  ostringstream source;
+  source << "fun int main()\n"
+         << "  var total = 0\n"
+         << "  for i = 1 to 10 do\n"
+         << "    total = total";
+  for (int k = 1; k < n; ++k)
+    source << " + " << (k % 2 == 0 ? "i" : "1");
+  source << "\n"
+         << "  end\n"
+         << "  return total\n"
+         << "end\n";
+  return source.str();
+}
+
+
+// DataObject, SymbolTable, and Heap operations
+void bench_micro(Bench& bench)
+{
+  bench.run("data_object/set_int", [&]() {
+    DataObject obj;
+    for (int i = 0; i < 64; ++i)
+      obj.set(i);
+    Bench::keep(obj);
+  }, cout);
+  DataObject text(string(40, 'x'));
+  bench.run("data_object/copy_string", [&]() {
+    DataObject copy(text);
+    Bench::keep(copy);
+  }, cout);
+  bench.run("data_object/append_string", [&]() {
+    DataObject obj("");
+    for (int i = 0; i < 64; ++i)
+      obj.append("ab");
+    Bench::keep(obj);
+  }, cout);
+  bench.run("symbol_table/push_add_pop", [&]() {
+    SymbolTable table;
+    table.push_environment();
+    for (int i = 0; i < 8; ++i) {
+      string name(1, 'a' + i);
+      table.add_name(name);
+      table.set_val_info(name, DataObject(i));
+    }
+    table.pop_environment();
+    Bench::keep(table);
+  }, cout);
+  // a name declared 8 environments out from the current one
+  SymbolTable nested;
+  nested.push_environment();
+  nested.add_name("x");
+  nested.set_val_info("x", DataObject(1));
+  for (int i = 0; i < 8; ++i) {
+    nested.push_environment();
+    nested.add_name("y" + to_string(i));
+  }
+  bench.run("symbol_table/lookup_depth_8", [&]() {
+    DataObject val;
+    nested.get_val_info("x", val);
+    Bench::keep(val);
+  }, cout);
+  bench.run("symbol_table/set_val", [&]() {
+    nested.set_val_info("x", DataObject(2));
+  }, cout);
+  // objects are never freed, so these reuse a fixed set of oids
+  Heap heap;
+  const size_t OBJECTS = 1024;
+  vector<size_t> oids;
+  HeapObject node;
+  node.set_att("val", DataObject(0));
+  node.set_att("next", DataObject());
+  for (size_t i = 0; i < OBJECTS; ++i) {
+    oids.push_back(heap.new_oid());
+    heap.set_obj(oids.back(), node);
+  }
+  size_t next = 0;
+  bench.run("heap/set_obj", [&]() {
+    heap.set_obj(oids[next++ % OBJECTS], node);
+  }, cout);
+  bench.run("heap/get_att", [&]() {
+    DataObject val;
+    heap.obj_ptr(oids[next++ % OBJECTS])->get_val("val", val);
+    Bench::keep(val);
+  }, cout);
+  MapObject map;
+  for (int i = 0; i < (int)OBJECTS; ++i)
+    map.put(DataObject(i), DataObject(i));
+  int key = 0;
+  bench.run("heap/map_put_get", [&]() {
+    DataObject val;
+    map.put(DataObject(key % (int)OBJECTS), DataObject(key));
+    map.get(DataObject((key * 7) % (int)OBJECTS), val);
+    ++key;
+    Bench::keep(val);
+  }, cout);
+}
+
+
+int main(int argc, char* argv[])
+{
+  Bench::Options options;
+  const char* json_path = nullptr;
+  string dir = "tests";
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+      json_path = argv[++i];
+    else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+      options.filter = argv[++i];
+    else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc)
+      options.reps = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+      options.warmup = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--min-batch-ms") == 0 && i + 1 < argc)
+      options.min_batch_ms = atof(argv[++i]);
+    else if (strncmp(argv[i], "--", 2) == 0) {
+      cerr << "unknown option " << argv[i] << endl;
+      return 1;
+    }
+    else
+      dir = argv[i];
+  }
+  Bench bench(options);
+  Bench::header(cout);
+  vector<string> names = programs(dir);
+  if (names.empty())
+    cerr << "no programs in " << dir << endl;
+  for (const string& name : names) {
+    ifstream file(dir + "/" + name);
+    string source((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    bench_program(bench, name, source);
+  }
+  for (int n : {1000, 10000})
+    for (const char* op : {"and", "or"})
+      bench_program(bench, string("cond_") + op + "_" + to_string(n), condition_program(n, op));
+  for (int n : {1000, 10000})
+    bench_program(bench, "sum_" + to_string(n), sum_program(n));
+  bench_micro(bench);
+  if (json_path != nullptr) {
+    ofstream json(json_path);
+    if (!json) {
+      cerr << "cannot write " << json_path << endl;
+      return 1;
+    }
+    bench.write_json(json);
+  }
+  return 0;
+}
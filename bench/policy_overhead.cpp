@@ -0,0 +1,100 @@
+//----------------------------------------------------------------------
+// NAME: Charles Walker
+// FILE: policy_overhead.cpp
+// DATE: Spring 2021
+// DESC: Cost of the interpreter's instrumentation hooks: runs a MyPL
+//       program (default bench/fuel_loop.mypl) on the
+//       NoInstrumentation and Instrumented interpreters (with the
+//       profiler and tracer off), alternating between them, and
+//       prints the best time of each (and its hardware counters, if
+//       perf_event_open is available). Build with optimization (the
+//       CMake build is -O0), e.g.:
+//
+//         g++ -std=c++11 -O2 -pthread bench/policy_overhead.cpp
+//
+//       usage: policy_overhead [program] [runs]
+//----------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include "../token.h"
+#include "../mypl_exception.h"
+#include "../lexer.h"
+#include "../parser.h"
+#include "../ast.h"
+#include "../type_checker.h"
+#include "../escape_analysis.h"
+#include "../interpreter.h"
+#include "../perf_counters.h"
+
+using namespace std;
+
+
+// the best time (in seconds) and its counters
+struct Best {
+  double secs = 1e9;
+  PerfCounters::Reading counts;
+};
+
+
+// run the program on a fresh interpreter with the policy
+template<typename Policy>
+void run(Program& program, const PerfCounters& counters, Best& best)
+{
+  ostringstream out;
+  istringstream in;
+  BasicInterpreter<Policy> interpreter(out, in);
+  PerfCounters::Reading before = counters.read();
+  auto start = chrono::steady_clock::now();
+  program.accept(interpreter);
+  double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  if (secs < best.secs) {
+    best.secs = secs;
+    best.counts = counters.read() - before;
+  }
+}
+
+
+int main(int argc, char* argv[])
+{
+  const char* path = argc > 1 ? argv[1] : "bench/fuel_loop.mypl";
+  int runs = argc > 2 ? atoi(argv[2]) : 5;
+  ifstream file(path);
+  if (!file) {
+    cerr << "cannot open " << path << endl;
+    return 1;
+  }
+  Program program;
+  try {
+    Lexer lexer(file);
+    Parser parser(lexer);
+    parser.parse(program);
+    TypeChecker type_checker;
+    program.accept(type_checker);
+    EscapeAnalysis escape_analysis;
+    program.accept(escape_analysis);
+  } catch (MyPLException& e) {
+    cerr << e.to_string() << endl;
+    return 1;
+  }
+  PerfCounters counters;
+  Best none;
+  Best instrumented;
+  for (int i = 0; i < runs; ++i) {
+    run<NoInstrumentation>(program, counters, none);
+    run<Instrumented>(program, counters, instrumented);
+  }
+  cout << "NoInstrumentation:  " << none.secs * 1000 << " ms\n"
+       << "Instrumented:       " << instrumented.secs * 1000 << " ms ("
+       << (instrumented.secs / none.secs - 1) * 100 << "%)\n";
+  if (counters.available()) {
+    PerfCounters::header(cout);
+    PerfCounters::row(cout, "none", none.counts);
+    PerfCounters::row(cout, "instrumented", instrumented.counts);
+  }
+}
@@ -0,0 +1,38 @@
+#!/bin/bash
+#----------------------------------------------------------------------
+# Per-input latency of a long REPL session: pipes N inputs (default
+# 10000) into `mypl` with no input file. Each input declares a
+# variable and returns a value that uses earlier variables and
+# functions; every 100th input also declares a function.
+#
+# usage: bench/repl_session.sh [mypl binary] [N]
+#----------------------------------------------------------------------
+
+MYPL=${1:-./mypl}
+N=${2:-10000}
+INPUT=$(mktemp)
+trap 'rm -f "$INPUT"' EXIT
+
+{
+  echo "fun int f0(n: int)"
+  echo "  return n + 1"
+  echo "end"
+  echo "var v0 = 0"
+  echo "return v0"
+  for ((i = 1; i < N; i++)); do
+    if ((i % 100 == 0)); then
+      echo "fun int f$i(n: int)"
+      echo "  return f0(n) + $i"
+      echo "end"
+    fi
+    echo "var v$i = $i"
+    echo "return v$i + f$((i / 100 * 100))(v$((i - 1)))"
+  done
+} > "$INPUT"
+
+START=$(date +%s%N)
+"$MYPL" < "$INPUT" > /dev/null
+STATUS=$?
+END=$(date +%s%N)
+MS=$(( (END - START) / 1000000 ))
+echo "$N inputs in $MS ms ($(( (END - START) / N / 1000 )) us/input), exit $STATUS"
@@ -0,0 +1,33 @@
+#!/bin/bash
+#----------------------------------------------------------------------
+# Scaling curves of each phase: generates programs of 1 KB, 10 KB, ...
+# up to MAX bytes (default 10 MB; 100 MB needs several GB of memory)
+# with gen_workload, runs each with mypl --time-phases, and prints one
+# CSV row per phase: bytes, phase, wall ms, RSS delta KB, and what the
+# phase produced. Options after the first three arguments are passed
+# to gen_workload to set the programs' shape (1 KB needs a small one,
+# e.g., --depth 0, or the program is one function of about 3 KB).
+#
+# usage: bench/scaling.sh [mypl binary] [gen_workload binary] [MAX]
+#                         [gen_workload options]
+#----------------------------------------------------------------------
+
+MYPL=${1:-./mypl}
+GEN=${2:-./gen_workload}
+MAX=${3:-10000000}
+shift $(( $# < 3 ? $# : 3 ))
+PROGRAM=$(mktemp --suffix=.mypl)
+trap 'rm -f "$PROGRAM"' EXIT
+
+echo "bytes,phase,ms,rss_delta_kb,produced"
+for ((size = 1000; size <= MAX; size *= 10)); do
+  "$GEN" --size $size "$@" > "$PROGRAM" || exit 1
+  BYTES=$(wc -c < "$PROGRAM")
+  "$MYPL" --time-phases "$PROGRAM" 2>&1 > /dev/null |
+    awk -v bytes="$BYTES" '
+      $1 ~ /^(lex|parse|typecheck|interpret)$/ {
+        produced = $0
+        sub(/^ *[^ ]+ +[^ ]+ +[^ ]+ +/, "", produced)
+        printf "%d,%s,%s,%d,\"%s\"\n", bytes, $1, $2, $3, produced
+      }'
+done
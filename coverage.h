@@ -0,0 +1,204 @@
+//----------------------------------------------------------------------
+// NAME: Charles Walker
+// FILE: coverage.h
+// DATE: Spring 2021
+// DESC: Line coverage of MyPL programs (mypl --coverage=FILE). The
+//       parser gives each statement a counter slot (Stmt::slot), and
+//       the Covered and Instrumented interpreters (instrumentation.h)
+//       count the statement's slot each time it runs. Each thread
+//       counts into its own array, so a hit is a bounds check and an
+//       increment; the arrays are added up for the report. Slots are
+//       mapped back to the statements' lines by walking the AST, and
+//       written as lcov tracefile records (DA:line,count) that tools
+//       like genhtml read. A line's count is that of its most run
+//       statement.
+//----------------------------------------------------------------------
+
+
+#ifndef COVERAGE_H
+#define COVERAGE_H
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "ast.h"
+
+
+class Coverage
+{
+public:
+
+  // count a run of the statement
+  static void hit(const Stmt& stmt);
+
+  // zero the counts of every thread
+  static void reset();
+
+  // the hits of each line of the program's statements (lines of
+  // statements that never ran have 0)
+  static std::map<int,size_t> line_hits(Program& program);
+
+  // write the program's line hits as an lcov record for source_path
+  static void write_lcov(std::ostream& out, Program& program, const std::string& source_path);
+
+private:
+
+  // the counts of a thread (plain data, so thread-local access needs
+  // no initialization check)
+  struct Counts {
+    size_t* hits;
+    size_t size;
+    std::vector<size_t>* counts;    // holds the hits
+  };
+  static thread_local Counts local;
+
+  // the counts of every thread that has counted (kept after the
+  // thread ends)
+  static std::mutex lock;
+  static std::vector<std::vector<size_t>*> threads;
+
+  // make room for the slot in the thread's counts, then count it
+  static void grow(size_t slot);
+
+  // the line a statement starts on
+  static int line(Stmt& stmt);
+
+  // add the lines of a statement list (and nested lists) to hits
+  static void add_lines(const std::list<Stmt*>& stmts, const std::vector<size_t>& totals,
+                        std::map<int,size_t>& hits);
+  static void add_line(Stmt& stmt, const std::vector<size_t>& totals,
+                       std::map<int,size_t>& hits);
+};
+
+
+thread_local Coverage::Counts Coverage::local;
+std::mutex Coverage::lock;
+std::vector<std::vector<size_t>*> Coverage::threads;
+
+
+void Coverage::hit(const Stmt& stmt)
+{
+  size_t slot = stmt.slot;
+  // a slot of -1 (not counted) is never below the size
+  if (slot < local.size)
+    ++local.hits[slot];
+  else if (stmt.slot >= 0)
+    grow(slot);
+}
+
+
+void Coverage::grow(size_t slot)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  std::vector<size_t>* counts = local.counts;
+  if (counts == nullptr) {
+    counts = local.counts = new std::vector<size_t>();
+    threads.push_back(counts);
+  }
+  counts->resize(std::max(std::max(slot + 1, 2 * counts->size()), (size_t)256));
+  local.hits = counts->data();
+  local.size = counts->size();
+  ++local.hits[slot];
+}
+
+
+void Coverage::reset()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  for (std::vector<size_t>* t : threads)
+    std::fill(t->begin(), t->end(), 0);
+}
+
+
+int Coverage::line(Stmt& stmt)
+{
+  Stmt* s = &stmt;
+  if (VarDeclStmt* v = dynamic_cast<VarDeclStmt*>(s))
+    return v->id.line();
+  if (AssignStmt* a = dynamic_cast<AssignStmt*>(s))
+    return a->lvalue_list.front().line();
+  if (ReturnStmt* r = dynamic_cast<ReturnStmt*>(s))
+    return r->expr ? r->expr->first_token().line() : 0;
+  if (IfStmt* i = dynamic_cast<IfStmt*>(s))
+    return i->if_part->expr->first_token().line();
+  if (WhileStmt* w = dynamic_cast<WhileStmt*>(s))
+    return w->expr->first_token().line();
+  if (ForStmt* f = dynamic_cast<ForStmt*>(s))
+    return f->var_id.line();
+  if (CallExpr* c = dynamic_cast<CallExpr*>(s))
+    return c->function_id.line();
+  return 0;
+}
+
+
+void Coverage::add_line(Stmt& stmt, const std::vector<size_t>& totals,
+                        std::map<int,size_t>& hits)
+{
+  int stmt_line = line(stmt);
+  if (stmt_line > 0) {
+    size_t count = stmt.slot >= 0 && (size_t)stmt.slot < totals.size() ? totals[stmt.slot] : 0;
+    size_t& line_count = hits[stmt_line];
+    line_count = std::max(line_count, count);
+  }
+  Stmt* s = &stmt;
+  if (IfStmt* i = dynamic_cast<IfStmt*>(s)) {
+    add_lines(i->if_part->stmts, totals, hits);
+    for (BasicIf* else_if : i->else_ifs)
+      add_lines(else_if->stmts, totals, hits);
+    add_lines(i->body_stmts, totals, hits);
+  }
+  else if (WhileStmt* w = dynamic_cast<WhileStmt*>(s))
+    add_lines(w->stmts, totals, hits);
+  else if (ForStmt* f = dynamic_cast<ForStmt*>(s))
+    add_lines(f->stmts, totals, hits);
+}
+
+
+void Coverage::add_lines(const std::list<Stmt*>& stmts, const std::vector<size_t>& totals,
+                         std::map<int,size_t>& hits)
+{
+  for (Stmt* s : stmts)
+    add_line(*s, totals, hits);
+}
+
+
+std::map<int,size_t> Coverage::line_hits(Program& program)
+{
+  std::vector<size_t> totals;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    for (std::vector<size_t>* t : threads) {
+      if (t->size() > totals.size())
+        totals.resize(t->size());
+      for (size_t i = 0; i < t->size(); ++i)
+        totals[i] += (*t)[i];
+    }
+  }
+  std::map<int,size_t> hits;
+  // (the fields of types are initialized by new, not run as
+  // statements, so are not counted)
+  for (Decl* d : program.decls)
+    if (FunDecl* f = dynamic_cast<FunDecl*>(d))
+      add_lines(f->stmts, totals, hits);
+  return hits;
+}
+
+
+void Coverage::write_lcov(std::ostream& out, Program& program, const std::string& source_path)
+{
+  std::map<int,size_t> hits = line_hits(program);
+  size_t hit_lines = 0;
+  out << "TN:\nSF:" << source_path << "\n";
+  for (auto& h : hits) {
+    out << "DA:" << h.first << "," << h.second << "\n";
+    if (h.second > 0)
+      ++hit_lines;
+  }
+  out << "LF:" << hits.size() << "\nLH:" << hit_lines << "\nend_of_record\n";
+}
+
+
+#endif
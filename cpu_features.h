@@ -0,0 +1,73 @@
+//----------------------------------------------------------------------
+// NAME: Charles Walker
+// FILE: cpu_features.h
+// DATE: Spring 2021
+// DESC: Runtime CPU feature detection for the MyPL interpreter. The
+//       native kernels (e.g., string_kernels.h) are compiled for
+//       several instruction sets and pick one at run time based on
+//       what the machine supports, so the interpreter binary itself
+//       does not need to be built with -mavx2.
+//----------------------------------------------------------------------
+
+
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MYPL_X86 1
+#endif
+
+
+class CPUFeatures
+{
+public:
+
+  // true if SSE2 instructions can be used
+  static bool sse2();
+
+  // true if AVX2 instructions can be used
+  static bool avx2();
+
+private:
+
+  CPUFeatures();
+
+  bool has_sse2 = false;
+  bool has_avx2 = false;
+
+  // detected once, on first use
+  static const CPUFeatures& features();
+};
+
+
+CPUFeatures::CPUFeatures()
+{
+#ifdef MYPL_X86
+  __builtin_cpu_init();
+  has_sse2 = __builtin_cpu_supports("sse2");
+  has_avx2 = __builtin_cpu_supports("avx2");
+#endif
+}
+
+
+const CPUFeatures& CPUFeatures::features()
+{
+  static const CPUFeatures detected;
+  return detected;
+}
+
+
+bool CPUFeatures::sse2()
+{
+  return features().has_sse2;
+}
+
+
+bool CPUFeatures::avx2()
+{
+  return features().has_avx2;
+}
+
+
+#endif
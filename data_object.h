@@ -5,13 +5,22 @@
 // Desc: For representing MyPL basic data values during
 //       interpretation. A DataType is essentially a container for a
 //       primitive value that can be set (modified) and retrieved.
+//       String values share a reference-counted buffer and refer to
+//       a prefix of it, so copying a string does not copy its
+//       characters, and appending to the value that holds the end of
+//       the buffer extends the buffer in place. The reference
+//       counts are atomic so values can be shared with parfor worker
+//       threads.
 //----------------------------------------------------------------------
 
 
 #ifndef DATA_OBJECT_H
 #define DATA_OBJECT_H
 
+#include <atomic>
 #include <string>
+#include <utility>
+#include "stats.h"
 
 
 
@@ -35,6 +44,8 @@ public:
   // copying
   DataObject(const DataObject& rhs);
   DataObject& operator=(const DataObject& rhs);
+  // exchange values (without copying them)
+  void swap(DataObject& rhs);
   // set/update
   void set(int val);
   void set(double val);
@@ -44,6 +55,11 @@ public:
   void set(bool val);
   void set(size_t val);
   void set_nil(); 
+  // append to a string value
+  void append(const std::string& val);
+  // set while other threads may hold string values (only unshared
+  // buffers are then extended in place)
+  static void set_threaded(bool on);
   // get and check type
   DataType type() const;
   bool is_nil() const;
@@ -60,15 +76,29 @@ public:
   bool value(char& val) const;
   bool value(bool& val) const;
   bool value(size_t& val) const;  
+  // get a string value without copying it (valid while the value is held)
+  bool value(const char*& chars, size_t& len) const;
   // get a string representation
   std::string to_string() const;
  private:
+  // shared string characters (values hold a prefix of chars)
+  struct StringBuffer {
+    std::string chars;
+    std::atomic<size_t> refs {1};
+  };
+  // (set by one interpreter's thread while other interpreters, e.g.,
+  // of a --batch run, read it on theirs)
+  static std::atomic<bool> threaded;
   void* value_ptr = nullptr;
   DataType value_type = DataType::NIL;
+  size_t str_len = 0;
   void delete_obj();
 };
 
 
+std::atomic<bool> DataObject::threaded {false};
+
+
 
 //----------------------------------------------------------------------
 // CONSTRUCTION
@@ -124,8 +154,11 @@ void DataObject::delete_obj()
     delete (int*)value_ptr;
   else if (value_type == DataType::DOUBLE)
     delete (double*)value_ptr;
-  else if (value_type == DataType::STRING)
-    delete (std::string*)value_ptr;
+  else if (value_type == DataType::STRING) {
+    StringBuffer* buf = (StringBuffer*)value_ptr;
+    if (--buf->refs == 0)
+      delete buf;
+  }
   else if (value_type == DataType::CHAR)
     delete (char*)value_ptr;
   else if (value_type == DataType::BOOL)
@@ -149,10 +182,18 @@ DataObject::DataObject(const DataObject& rhs)
   *this = rhs;
 }
 
+void DataObject::swap(DataObject& rhs)
+{
+  std::swap(value_ptr, rhs.value_ptr);
+  std::swap(value_type, rhs.value_type);
+  std::swap(str_len, rhs.str_len);
+}
+
 DataObject& DataObject::operator=(const DataObject& rhs)
 {
   if (this == &rhs)
     return *this;
+  Stats::data_copy();
   if (rhs.is_integer()) {
     int v;
     rhs.value(v);
@@ -164,9 +205,13 @@ DataObject& DataObject::operator=(const DataObject& rhs)
     set(v);
   }
   else if (rhs.is_string()) {
-    std::string v;
-    rhs.value(v);
-    set(v);
+    // share the buffer
+    StringBuffer* buf = (StringBuffer*)rhs.value_ptr;
+    ++buf->refs;
+    delete_obj();
+    value_ptr = buf;
+    str_len = rhs.str_len;
+    value_type = DataType::STRING;
   }
   else if (rhs.is_char()) {
     char v;
@@ -197,6 +242,7 @@ DataObject& DataObject::operator=(const DataObject& rhs)
 void DataObject::set(int val)
 {
   delete_obj();
+  Stats::data_alloc();
   value_ptr = new int;
   *((int*)value_ptr) = val;
   value_type = DataType::INTEGER;
@@ -205,6 +251,7 @@ void DataObject::set(int val)
 void DataObject::set(double val)
 {
   delete_obj();
+  Stats::data_alloc();
   value_ptr = new double;
   *((double*)value_ptr) = val;
   value_type = DataType::DOUBLE;
@@ -212,23 +259,24 @@ void DataObject::set(double val)
 
 void DataObject::set(const char* val)
 {
-  delete_obj();
-  value_ptr = new std::string;
-  *((std::string*)value_ptr) = val;
-  value_type = DataType::STRING;
+  set(std::string(val));
 }
 
 void DataObject::set(const std::string& val)
 {
+  StringBuffer* buf = new StringBuffer;
+  Stats::data_alloc();
+  buf->chars = val;
   delete_obj();
-  value_ptr = new std::string;
-  *((std::string*)value_ptr) = val;
+  value_ptr = buf;
+  str_len = val.size();
   value_type = DataType::STRING;
 }
 
 void DataObject::set(char val)
 {
   delete_obj();
+  Stats::data_alloc();
   value_ptr = new char;
   *((char*)value_ptr) = val;
   value_type = DataType::CHAR;
@@ -237,6 +285,7 @@ void DataObject::set(char val)
 void DataObject::set(bool val)
 {
   delete_obj();
+  Stats::data_alloc();
   value_ptr = new bool;
   *((bool*)value_ptr) = val;
   value_type = DataType::BOOL;
@@ -245,6 +294,7 @@ void DataObject::set(bool val)
 void DataObject::set(size_t val)
 {
   delete_obj();
+  Stats::data_alloc();
   value_ptr = new size_t;
   *((size_t*)value_ptr) = val;
   value_type = DataType::OID;
@@ -257,6 +307,35 @@ void DataObject::set_nil()
   value_type = DataType::NIL;
 }
 
+void DataObject::append(const std::string& val)
+{
+  if (value_type != DataType::STRING)
+    return;
+  StringBuffer* buf = (StringBuffer*)value_ptr;
+  if (buf->refs == 1)
+    // sole owner, any characters past our prefix are unused
+    buf->chars.resize(str_len);
+  else if (threaded.load(std::memory_order_acquire) or str_len != buf->chars.size()) {
+    // another value already extended the buffer (or another thread
+    // may be extending it), so copy our prefix
+    StringBuffer* copy = new StringBuffer;
+    Stats::data_alloc();
+    copy->chars.reserve(2 * (str_len + val.size()));
+    copy->chars.assign(buf->chars, 0, str_len);
+    --buf->refs;
+    buf = copy;
+    value_ptr = buf;
+  }
+  buf->chars.append(val);
+  str_len = buf->chars.size();
+}
+
+
+void DataObject::set_threaded(bool on)
+{
+  threaded.store(on, std::memory_order_release);
+}
+
 
 //----------------------------------------------------------------------
 // GET TYPE
@@ -327,7 +406,16 @@ bool DataObject::value(std::string& val) const
 {
   if (value_type != DataType::STRING or !value_ptr)
     return false;
-  val = *((std::string*)value_ptr);
+  val.assign(((StringBuffer*)value_ptr)->chars, 0, str_len);
+  return true;
+}
+
+bool DataObject::value(const char*& chars, size_t& len) const
+{
+  if (value_type != DataType::STRING or !value_ptr)
+    return false;
+  chars = ((StringBuffer*)value_ptr)->chars.data();
+  len = str_len;
   return true;
 }
 
@@ -369,13 +457,14 @@ std::string DataObject::to_string() const
   else if (value_type == DataType::DOUBLE)
     return std::to_string(*((double*)value_ptr));
   else if (value_type == DataType::STRING)
-    return *((std::string*)value_ptr);
+    return ((StringBuffer*)value_ptr)->chars.substr(0, str_len);
   else if (value_type == DataType::CHAR)
-    return std::to_string(*((char*)value_ptr));
+    return std::string(1, *((char*)value_ptr));
   else if (value_type == DataType::BOOL)
     return std::to_string(*((bool*)value_ptr));
   else if (value_type == DataType::OID)
     return std::to_string(*((size_t*)value_ptr));
+  return "";
 }
 
 
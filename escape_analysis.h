@@ -0,0 +1,466 @@
+//----------------------------------------------------------------------
+// NAME: Charles Walker
+// FILE: escape_analysis.h
+// DATE: Spring 2021
+// DESC: Escape analysis for MyPL. Finds the `new` expressions in
+//       function bodies whose objects can never be reached once the
+//       function returns, i.e., the object is not returned, not
+//       stored into another object, and not passed to a parameter
+//       that escapes (storing it into an array element also counts
+//       as escaping). Such NewRValue nodes are marked frame_local so
+//       the interpreter allocates them in the call frame instead of
+//       the heap. Variables that are assigned to one another are
+//       treated as aliases, and a parameter escapes if any of its
+//       aliases do. Parameter results are iterated to a fixed point
+//       to handle (mutually) recursive functions. Variables used in
+//       a parfor body but declared outside of it escape, as do the
+//       arguments of spawned calls, since other threads can only
+//       reach heap objects.
+//----------------------------------------------------------------------
+
+
+#ifndef ESCAPE_ANALYSIS_H
+#define ESCAPE_ANALYSIS_H
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "ast.h"
+
+
+class EscapeAnalysis : public Visitor
+{
+public:
+
+  // top-level
+  void visit(Program& node);
+  void visit(FunDecl& node);
+  void visit(TypeDecl& node);
+  void visit(Repl& node);
+  // statements
+  void visit(ReplEndpoint& node);
+  void visit(VarDeclStmt& node);
+  void visit(AssignStmt& node);
+  void visit(ReturnStmt& node);
+  void visit(IfStmt& node);
+  void visit(WhileStmt& node);
+  void visit(ForStmt& node);
+  void visit(ParForStmt& node);
+  // expressions
+  void visit(Expr& node);
+  void visit(SimpleTerm& node);
+  void visit(ComplexTerm& node);
+  // rvalues
+  void visit(SimpleRValue& node);
+  void visit(NewRValue& node);
+  void visit(CallExpr& node);
+  void visit(IDRValue& node);
+  void visit(NegatedRValue& node);
+  void visit(ArrayRValue& node);
+  void visit(SpawnRValue& node);
+
+private:
+
+  // the user-defined functions
+  std::unordered_map<std::string,FunDecl*> functions;
+
+  // for each function, whether each of its parameters escapes
+  std::unordered_map<std::string,std::vector<bool>> param_escapes;
+
+  // set when a parameter result changes during a pass
+  bool changed = false;
+
+  // the variables of the function being analyzed: each name maps to
+  // its alias-set parent (union-find) and whether the set escapes
+  std::unordered_map<std::string,std::string> alias_parent;
+  std::unordered_map<std::string,bool> alias_escapes;
+
+  // the new expressions bound to a variable in the current function
+  std::list<std::pair<std::string,NewRValue*>> allocations;
+
+  // the number of enclosing parfor bodies, and the variables declared
+  // within the outermost one
+  int parfor_depth = 0;
+  std::unordered_set<std::string> parfor_locals;
+
+  // a variable used in a parfor body (escapes if declared outside)
+  void parfor_use(const std::string& name);
+
+  // alias-set helpers
+  std::string find(const std::string& name);
+  void unite(const std::string& name1, const std::string& name2);
+  void escape(const std::string& name);
+
+  // the variable name if the expression is just a variable (or "")
+  std::string bare_id(Expr* expr) const;
+
+  // the new expression if the expression is just a new (or nullptr)
+  NewRValue* bare_new(Expr* expr) const;
+
+  // a value flowing into the given variable
+  void bind(const std::string& name, Expr* expr);
+};
+
+
+//----------------------------------------------------------------------
+// Helper functions
+//----------------------------------------------------------------------
+
+std::string EscapeAnalysis::find(const std::string& name)
+{
+  if (alias_parent.count(name) == 0) {
+    alias_parent[name] = name;
+    alias_escapes[name] = false;
+    return name;
+  }
+  std::string root = name;
+  while (alias_parent[root] != root)
+    root = alias_parent[root];
+  // path compression
+  std::string curr = name;
+  while (alias_parent[curr] != root) {
+    std::string next = alias_parent[curr];
+    alias_parent[curr] = root;
+    curr = next;
+  }
+  return root;
+}
+
+
+void EscapeAnalysis::unite(const std::string& name1, const std::string& name2)
+{
+  std::string root1 = find(name1);
+  std::string root2 = find(name2);
+  if (root1 == root2)
+    return;
+  alias_parent[root2] = root1;
+  alias_escapes[root1] = alias_escapes[root1] or alias_escapes[root2];
+}
+
+
+void EscapeAnalysis::escape(const std::string& name)
+{
+  alias_escapes[find(name)] = true;
+}
+
+
+std::string EscapeAnalysis::bare_id(Expr* expr) const
+{
+  while (expr and !expr->op and !expr->negated) {
+    if (ComplexTerm* c = dynamic_cast<ComplexTerm*>(expr->first))
+      expr = c->expr;
+    else if (SimpleTerm* s = dynamic_cast<SimpleTerm*>(expr->first)) {
+      IDRValue* v = dynamic_cast<IDRValue*>(s->rvalue);
+      if (v and v->path.size() == 1)
+        return v->path.front().lexeme();
+      return "";
+    }
+    else
+      return "";
+  }
+  return "";
+}
+
+
+NewRValue* EscapeAnalysis::bare_new(Expr* expr) const
+{
+  while (expr and !expr->op and !expr->negated) {
+    if (ComplexTerm* c = dynamic_cast<ComplexTerm*>(expr->first))
+      expr = c->expr;
+    else if (SimpleTerm* s = dynamic_cast<SimpleTerm*>(expr->first)) {
+      // arrays and vecs are always heap allocated
+      NewRValue* n = dynamic_cast<NewRValue*>(s->rvalue);
+      if (n and (n->array_size or n->vec_length))
+        return nullptr;
+      return n;
+    }
+    else
+      return nullptr;
+  }
+  return nullptr;
+}
+
+
+void EscapeAnalysis::parfor_use(const std::string& name)
+{
+  if (parfor_depth > 0 and parfor_locals.count(name) == 0)
+    escape(name);
+}
+
+
+void EscapeAnalysis::bind(const std::string& name, Expr* expr)
+{
+  if (NewRValue* n = bare_new(expr)) {
+    find(name);
+    allocations.push_back({name, n});
+    return;
+  }
+  std::string rhs = bare_id(expr);
+  if (rhs != "")
+    unite(name, rhs);
+  expr->accept(*this);
+}
+
+
+//----------------------------------------------------------------------
+// Function, Variable, and Type Declarations
+//----------------------------------------------------------------------
+
+void EscapeAnalysis::visit(Program& node)
+{
+  for (Decl* d : node.decls) {
+    if (FunDecl* f = dynamic_cast<FunDecl*>(d)) {
+      functions[f->id.lexeme()] = f;
+      param_escapes[f->id.lexeme()] = std::vector<bool>(f->params.size(), false);
+    }
+  }
+  // parameter results only grow, so this terminates
+  do {
+    changed = false;
+    for (std::pair<std::string,FunDecl*> f : functions)
+      f.second->accept(*this);
+  } while (changed);
+}
+
+
+void EscapeAnalysis::visit(FunDecl& node)
+{
+  alias_parent.clear();
+  alias_escapes.clear();
+  allocations.clear();
+  for (Stmt* s : node.stmts)
+    s->accept(*this);
+  // objects bound only to non-escaping variables stay in the frame
+  for (std::pair<std::string,NewRValue*> a : allocations)
+    a.second->frame_local = !alias_escapes[find(a.first)];
+  std::vector<bool>& escapes = param_escapes[node.id.lexeme()];
+  int i = 0;
+  for (FunDecl::FunParam param : node.params) {
+    bool e = alias_escapes[find(param.id.lexeme())];
+    if (e and !escapes[i]) {
+      escapes[i] = true;
+      changed = true;
+    }
+    ++i;
+  }
+}
+
+
+void EscapeAnalysis::visit(TypeDecl& node)
+{
+  // attribute initializers are stored into objects (heap allocated)
+}
+
+
+void EscapeAnalysis::visit(Repl& node)
+{
+  // repl statements are not inside a call frame
+}
+
+
+//----------------------------------------------------------------------
+// Statement nodes
+//----------------------------------------------------------------------
+
+void EscapeAnalysis::visit(ReplEndpoint& node)
+{
+}
+
+
+void EscapeAnalysis::visit(VarDeclStmt& node)
+{
+  if (parfor_depth > 0) {
+    // a shadowed outer variable is treated as used
+    if (parfor_locals.count(node.id.lexeme()) == 0 and alias_parent.count(node.id.lexeme()))
+      escape(node.id.lexeme());
+    parfor_locals.insert(node.id.lexeme());
+  }
+  bind(node.id.lexeme(), node.expr);
+}
+
+
+void EscapeAnalysis::visit(AssignStmt& node)
+{
+  parfor_use(node.lvalue_list.front().lexeme());
+  for (Expr* e : node.indices)
+    e->accept(*this);
+  if (node.lvalue_list.size() == 1 and node.indices.empty()) {
+    bind(node.lvalue_list.front().lexeme(), node.expr);
+    return;
+  }
+  // stored into an object attribute or array element
+  std::string rhs = bare_id(node.expr);
+  if (rhs != "")
+    escape(rhs);
+  node.expr->accept(*this);
+}
+
+
+void EscapeAnalysis::visit(ReturnStmt& node)
+{
+  std::string rhs = bare_id(node.expr);
+  if (rhs != "")
+    escape(rhs);
+  node.expr->accept(*this);
+}
+
+
+void EscapeAnalysis::visit(IfStmt& node)
+{
+  node.if_part->expr->accept(*this);
+  for (Stmt* s : node.if_part->stmts)
+    s->accept(*this);
+  for (BasicIf* b : node.else_ifs) {
+    b->expr->accept(*this);
+    for (Stmt* s : b->stmts)
+      s->accept(*this);
+  }
+  for (Stmt* s : node.body_stmts)
+    s->accept(*this);
+}
+
+
+void EscapeAnalysis::visit(WhileStmt& node)
+{
+  node.expr->accept(*this);
+  for (Stmt* s : node.stmts)
+    s->accept(*this);
+}
+
+
+void EscapeAnalysis::visit(ForStmt& node)
+{
+  node.start->accept(*this);
+  node.end->accept(*this);
+  for (Stmt* s : node.stmts)
+    s->accept(*this);
+}
+
+
+void EscapeAnalysis::visit(ParForStmt& node)
+{
+  node.start->accept(*this);
+  node.end->accept(*this);
+  ++parfor_depth;
+  parfor_locals.insert(node.var_id.lexeme());
+  for (Stmt* s : node.stmts)
+    s->accept(*this);
+  if (--parfor_depth == 0)
+    parfor_locals.clear();
+}
+
+
+//----------------------------------------------------------------------
+// Expressions and Expression Terms
+//----------------------------------------------------------------------
+
+void EscapeAnalysis::visit(Expr& node)
+{
+  // from the innermost expression on the left out (see left_spine)
+  std::vector<Expr*> spine;
+  left_spine(node, spine);
+  spine.back()->first->accept(*this);
+  for (auto e = spine.rbegin(); e != spine.rend(); ++e)
+    if ((*e)->rest)
+      (*e)->rest->accept(*this);
+}
+
+
+void EscapeAnalysis::visit(SimpleTerm& node)
+{
+  node.rvalue->accept(*this);
+}
+
+
+void EscapeAnalysis::visit(ComplexTerm& node)
+{
+  node.expr->accept(*this);
+}
+
+
+//----------------------------------------------------------------------
+// RValue nodes
+//----------------------------------------------------------------------
+
+void EscapeAnalysis::visit(SimpleRValue& node)
+{
+}
+
+
+void EscapeAnalysis::visit(NewRValue& node)
+{
+  // a new that is not directly bound stays on the heap
+  if (node.array_size)
+    node.array_size->accept(*this);
+  if (node.vec_length)
+    node.vec_length->accept(*this);
+}
+
+
+void EscapeAnalysis::visit(CallExpr& node)
+{
+  // put and push store their value into a map or pqueue; other
+  // built-in functions do not hold on to their arguments
+  std::string fun_name = node.function_id.lexeme();
+  if ((fun_name == "put" or fun_name == "push") and node.arg_list.size() == 3) {
+    std::string val = bare_id(node.arg_list.back());
+    if (val != "")
+      escape(val);
+  }
+  auto f = param_escapes.find(node.function_id.lexeme());
+  size_t i = 0;
+  for (Expr* e : node.arg_list) {
+    if (f != param_escapes.end() and i < f->second.size()) {
+      bool escapes = f->second[i];
+      std::string arg = bare_id(e);
+      NewRValue* n = bare_new(e);
+      if (arg != "" and escapes)
+        escape(arg);
+      else if (n)
+        n->frame_local = !escapes;
+    }
+    e->accept(*this);
+    ++i;
+  }
+}
+
+
+void EscapeAnalysis::visit(IDRValue& node)
+{
+  parfor_use(node.path.front().lexeme());
+  for (Expr* e : node.indices)
+    e->accept(*this);
+}
+
+
+void EscapeAnalysis::visit(NegatedRValue& node)
+{
+  node.expr->accept(*this);
+}
+
+
+void EscapeAnalysis::visit(ArrayRValue& node)
+{
+  // elements are stored into the array
+  for (Expr* e : node.elements) {
+    std::string elem = bare_id(e);
+    if (elem != "")
+      escape(elem);
+    e->accept(*this);
+  }
+}
+
+
+void EscapeAnalysis::visit(SpawnRValue& node)
+{
+  // the arguments are handed to another thread
+  for (Expr* e : node.call->arg_list) {
+    std::string arg = bare_id(e);
+    if (arg != "")
+      escape(arg);
+    e->accept(*this);
+  }
+}
+
+
+#endif
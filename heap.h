@@ -8,13 +8,24 @@
 //       pairs. The keys denote user-defined type variable names and
 //       the values denote the corresponding variable values. Each
 //       value is represented as a DataObject. The key-value pairs are
-//       represented as HeapObjects.
+//       represented as HeapObjects. Arrays are stored in the heap as
+//       ArrayObjects, maps as MapObjects, priority queues as
+//       PQueueObjects, and spawned tasks as TaskObjects, all sharing
+//       the same OID space. Once worker threads are started, the heap
+//       tables are guarded by a lock, and the contents of each object
+//       by one of a set of locks.
 //----------------------------------------------------------------------
 
 #ifndef HEAP_H
 #define HEAP_H
 
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <string>
 #include <unordered_map>
+#include <vector>
 #include "data_object.h"
 
 
@@ -55,10 +66,301 @@ private:
 };
 
 
+class ArrayObject
+{
+public:
+
+  //----------------------------------------------------------------------
+  // Create an array. Int and double elements are stored unboxed in
+  // contiguous memory, all other element types as data objects.
+  // Inputs:
+  //   elem_type -- the type of the array elements
+  //   size -- the number of elements
+  //   init -- the initial value of each element
+  //----------------------------------------------------------------------
+  ArrayObject(DataObject::DataType elem_type = DataObject::NIL,
+              size_t size = 0, const DataObject& init = DataObject());
+
+  //----------------------------------------------------------------------
+  // Returns:
+  //   the number of elements in the array
+  //----------------------------------------------------------------------
+  size_t size() const;
+
+  //----------------------------------------------------------------------
+  // Get the value of the given element (the index must be in range)
+  // Inputs:
+  //   index -- the element index
+  // Outputs:
+  //   val -- the value of the element
+  //----------------------------------------------------------------------
+  void get(size_t index, DataObject& val) const;
+
+  //----------------------------------------------------------------------
+  // Set the value of the given element (the index must be in range)
+  // Inputs:
+  //   index -- the element index
+  //   val -- the new element value
+  // Returns:
+  //   false if the value cannot be stored in the array (nil in an
+  //   int or double array), true otherwise
+  //----------------------------------------------------------------------
+  bool set(size_t index, const DataObject& val);
+
+  //----------------------------------------------------------------------
+  // Returns:
+  //   the contiguous elements of a double array (for the vec kernels)
+  //----------------------------------------------------------------------
+  double* doubles();
+  const double* doubles() const;
+
+private:
+  DataObject::DataType elem_type;
+  std::vector<int> int_vals;
+  std::vector<double> double_vals;
+  std::vector<DataObject> obj_vals;
+};
+
+
+class MapObject
+{
+public:
+
+  //----------------------------------------------------------------------
+  // Create an empty map. Maps are open-addressing hash tables with
+  // linear probing. The stored hash codes are kept in their own
+  // array so a probe only touches the keys whose hash matches.
+  // Inputs:
+  //   key_type -- the type of the keys (INTEGER or STRING)
+  //----------------------------------------------------------------------
+  MapObject(DataObject::DataType key_type = DataObject::INTEGER);
+
+  //----------------------------------------------------------------------
+  // Returns:
+  //   the number of keys in the map
+  //----------------------------------------------------------------------
+  size_t size() const;
+
+  //----------------------------------------------------------------------
+  // Get the value of a key.
+  // Inputs:
+  //   key -- the key to look up
+  // Outputs:
+  //   val -- the value of the key
+  // Returns:
+  //   true if the key is in the map, false otherwise
+  //----------------------------------------------------------------------
+  bool get(const DataObject& key, DataObject& val) const;
+
+  //----------------------------------------------------------------------
+  // Check if a key is in the map.
+  // Inputs:
+  //   key -- the key to check for
+  // Returns:
+  //   true if the key is in the map, false otherwise
+  //----------------------------------------------------------------------
+  bool has(const DataObject& key) const;
+
+  //----------------------------------------------------------------------
+  // Add or update a key.
+  // Inputs:
+  //   key -- the key to add or update
+  //   val -- the new value of the key
+  //----------------------------------------------------------------------
+  void put(const DataObject& key, const DataObject& val);
+
+  //----------------------------------------------------------------------
+  // Remove a key.
+  // Inputs:
+  //   key -- the key to remove
+  // Returns:
+  //   true if the key was in the map, false otherwise
+  //----------------------------------------------------------------------
+  bool remove(const DataObject& key);
+
+private:
+  // slot states stored in place of a hash code (real codes are >= 2)
+  static const size_t EMPTY = 0;
+  static const size_t DELETED = 1;
+
+  DataObject::DataType key_type;
+  size_t count = 0;     // keys in the map
+  size_t used = 0;      // keys plus deleted slots
+  std::vector<size_t> hashes;
+  std::vector<int> int_keys;
+  std::vector<std::string> str_keys;
+  std::vector<DataObject> vals;
+
+  // the hash code of a key (never EMPTY or DELETED)
+  size_t hash(const DataObject& key) const;
+
+  // the slot holding the key, or the table size if not found
+  size_t find(const DataObject& key, size_t code) const;
+
+  // store a key in the first free slot of its probe sequence
+  void insert(size_t code, const DataObject& key, const DataObject& val);
+
+  // rebuild the table with the given number of slots
+  void rehash(size_t slots);
+};
+
+
+class PQueueObject
+{
+public:
+
+  //----------------------------------------------------------------------
+  // Returns:
+  //   the number of values in the queue
+  //----------------------------------------------------------------------
+  size_t size() const;
+
+  //----------------------------------------------------------------------
+  // Add a value to the queue. Values come out in increasing priority
+  // order, and values with the same priority in the order they were
+  // pushed.
+  // Inputs:
+  //   priority -- the priority of the value (ints are stored exactly)
+  //   val -- the value
+  //----------------------------------------------------------------------
+  void push(double priority, const DataObject& val);
+
+  //----------------------------------------------------------------------
+  // Get the value with the smallest priority (the queue must not be
+  // empty).
+  // Outputs:
+  //   val -- the value at the front of the queue
+  //----------------------------------------------------------------------
+  void peek(DataObject& val) const;
+
+  //----------------------------------------------------------------------
+  // Remove the value with the smallest priority (the queue must not
+  // be empty).
+  // Outputs:
+  //   val -- the removed value
+  //----------------------------------------------------------------------
+  void pop(DataObject& val);
+
+private:
+  struct Entry {
+    double priority;
+    size_t order;       // push count, to keep equal priorities FIFO
+    DataObject val;
+  };
+
+  // a binary min-heap stored in one contiguous array
+  std::vector<Entry> entries;
+  size_t pushed = 0;
+
+  // true if entry i must come out before entry j
+  bool before(size_t i, size_t j) const;
+
+  // exchange entries i and j (without copying their values)
+  void swap(size_t i, size_t j);
+};
+
+
+class TaskObject
+{
+public:
+
+  //----------------------------------------------------------------------
+  // Returns:
+  //   true once the task has finished (with a result or an error)
+  //----------------------------------------------------------------------
+  bool done() const;
+
+  //----------------------------------------------------------------------
+  // Record the task's result (or error). Called once, by the thread
+  // that ran the task.
+  // Inputs:
+  //   val -- the value returned by the task's function
+  //   error -- the exception raised by the task's function
+  //----------------------------------------------------------------------
+  void finish(const DataObject& val);
+  void fail(std::exception_ptr error);
+
+  //----------------------------------------------------------------------
+  // Get the result of a finished task, rethrowing its error if it
+  // failed.
+  // Outputs:
+  //   val -- the value returned by the task's function
+  //----------------------------------------------------------------------
+  void result(DataObject& val) const;
+
+private:
+  std::atomic<bool> finished {false};
+  DataObject value;
+  std::exception_ptr error;
+};
+
+
 class Heap
 {
 public:
 
+  //----------------------------------------------------------------------
+  // Get a fresh oid (safe to call from several threads).
+  // Returns:
+  //   an oid not yet used by any object
+  //----------------------------------------------------------------------
+  size_t new_oid();
+
+  //----------------------------------------------------------------------
+  // Turn locking on or off. Locking must be on while more than one
+  // thread uses the heap, and may only be changed while one does.
+  // Inputs:
+  //   on -- true if the heap is shared by several threads
+  //----------------------------------------------------------------------
+  void set_concurrent(bool on);
+
+  //----------------------------------------------------------------------
+  // Lock the contents (attributes, elements, or entries) of an object
+  // while locking is on. Storing a value frees the one it replaces,
+  // so a load or store on one thread must not overlap a store to the
+  // same place on another. Objects share a fixed set of locks (by
+  // address), so only one may be held at a time.
+  // Inputs:
+  //   contents -- the address of the object
+  // Returns:
+  //   the held lock (or an empty one if locking is off)
+  //----------------------------------------------------------------------
+  std::unique_lock<std::mutex> lock_contents(const void* contents) const;
+
+  //----------------------------------------------------------------------
+  // Limit the size of the heap. Sizes are counted in cells: one per
+  // object plus one per attribute, array element, and map or
+  // priority queue entry.
+  // Inputs:
+  //   cells -- the most cells the heap may hold (0 for no limit)
+  //----------------------------------------------------------------------
+  void set_max_cells(size_t cells);
+
+  //----------------------------------------------------------------------
+  // Check if the heap's size is limited.
+  // Returns:
+  //   true if a limit was set
+  //----------------------------------------------------------------------
+  bool has_max_cells() const;
+
+  //----------------------------------------------------------------------
+  // Account for new cells before adding them (safe to call from
+  // several threads).
+  // Inputs:
+  //   cells -- the number of cells to be added
+  // Returns:
+  //   false (and nothing is counted) if the limit would be exceeded
+  //----------------------------------------------------------------------
+  bool reserve(size_t cells);
+
+  //----------------------------------------------------------------------
+  // Give back cells that were reserved (safe to call from several
+  // threads).
+  // Inputs:
+  //   cells -- the number of cells no longer held
+  //----------------------------------------------------------------------
+  void release(size_t cells);
+
   //----------------------------------------------------------------------
   // Add or update the oid with the given heap object.
   // Inputs:
@@ -87,8 +389,103 @@ public:
   //----------------------------------------------------------------------
   bool get_obj(size_t oid, HeapObject& obj) const;
 
+  //----------------------------------------------------------------------
+  // Get the user-defined type object associated with the given oid
+  // without copying it, so its attributes can be read or updated in
+  // place.
+  // Inputs:
+  //   oid -- the oid to look up
+  // Returns:
+  //   the heap object, or nullptr if the oid is not in the heap
+  //----------------------------------------------------------------------
+  HeapObject* obj_ptr(size_t oid);
+
+  //----------------------------------------------------------------------
+  // Add or update the oid with the given array.
+  // Inputs:
+  //   oid -- the oid to add or update
+  //   obj -- the array
+  //----------------------------------------------------------------------
+  void set_array(size_t oid, const ArrayObject& obj);
+
+  //----------------------------------------------------------------------
+  // Get the array associated with the given oid without copying it.
+  // Inputs:
+  //   oid -- the oid to look up
+  // Returns:
+  //   the array, or nullptr if the oid is not an array in the heap
+  //----------------------------------------------------------------------
+  ArrayObject* array_ptr(size_t oid);
+
+  //----------------------------------------------------------------------
+  // Add or update the oid with the given map.
+  // Inputs:
+  //   oid -- the oid to add or update
+  //   obj -- the map
+  //----------------------------------------------------------------------
+  void set_map(size_t oid, const MapObject& obj);
+
+  //----------------------------------------------------------------------
+  // Get the map associated with the given oid without copying it.
+  // Inputs:
+  //   oid -- the oid to look up
+  // Returns:
+  //   the map, or nullptr if the oid is not a map in the heap
+  //----------------------------------------------------------------------
+  MapObject* map_ptr(size_t oid);
+
+  //----------------------------------------------------------------------
+  // Add or update the oid with the given priority queue.
+  // Inputs:
+  //   oid -- the oid to add or update
+  //   obj -- the priority queue
+  //----------------------------------------------------------------------
+  void set_pqueue(size_t oid, const PQueueObject& obj);
+
+  //----------------------------------------------------------------------
+  // Get the priority queue associated with the given oid without
+  // copying it.
+  // Inputs:
+  //   oid -- the oid to look up
+  // Returns:
+  //   the queue, or nullptr if the oid is not a queue in the heap
+  //----------------------------------------------------------------------
+  PQueueObject* pqueue_ptr(size_t oid);
+
+  //----------------------------------------------------------------------
+  // Add a new (unfinished) task with the given oid.
+  // Inputs:
+  //   oid -- the oid of the task
+  // Returns:
+  //   the task, which stays at the same address
+  //----------------------------------------------------------------------
+  TaskObject* new_task(size_t oid);
+
+  //----------------------------------------------------------------------
+  // Get the task associated with the given oid.
+  // Inputs:
+  //   oid -- the oid to look up
+  // Returns:
+  //   the task, or nullptr if the oid is not a task in the heap
+  //----------------------------------------------------------------------
+  TaskObject* task_ptr(size_t oid);
+
 private:
+  std::atomic<size_t> next_oid {0};
+  bool concurrent = false;
+  size_t max_cells = 0;
+  std::atomic<size_t> used_cells {0};
+  mutable std::mutex heap_lock;
+  static const size_t CONTENTS_LOCKS = 64;
+  mutable std::mutex contents_locks[CONTENTS_LOCKS];
   std::unordered_map<size_t, HeapObject> heap_objs;
+  std::unordered_map<size_t, ArrayObject> heap_arrays;
+  std::unordered_map<size_t, MapObject> heap_maps;
+  std::unordered_map<size_t, PQueueObject> heap_pqueues;
+  std::unordered_map<size_t, TaskObject> heap_tasks;
+
+  // holds the heap lock if locking is on
+  std::unique_lock<std::mutex> guard() const;
 };
 
 
@@ -115,29 +512,490 @@ bool HeapObject::get_val(const std::string& att, DataObject& val)
 }
 
 
+//----------------------------------------------------------------------
+// ArrayObject Member Functions
+//----------------------------------------------------------------------
+
+ArrayObject::ArrayObject(DataObject::DataType elem_type, size_t size,
+                         const DataObject& init)
+  : elem_type(elem_type)
+{
+  int int_val = 0;
+  double double_val = 0.0;
+  if (elem_type == DataObject::INTEGER) {
+    init.value(int_val);
+    int_vals.assign(size, int_val);
+  }
+  else if (elem_type == DataObject::DOUBLE) {
+    init.value(double_val);
+    double_vals.assign(size, double_val);
+  }
+  else
+    obj_vals.assign(size, init);
+}
+
+size_t ArrayObject::size() const
+{
+  if (elem_type == DataObject::INTEGER)
+    return int_vals.size();
+  else if (elem_type == DataObject::DOUBLE)
+    return double_vals.size();
+  return obj_vals.size();
+}
+
+void ArrayObject::get(size_t index, DataObject& val) const
+{
+  if (elem_type == DataObject::INTEGER)
+    val.set(int_vals[index]);
+  else if (elem_type == DataObject::DOUBLE)
+    val.set(double_vals[index]);
+  else
+    val = obj_vals[index];
+}
+
+bool ArrayObject::set(size_t index, const DataObject& val)
+{
+  if (elem_type == DataObject::INTEGER)
+    return val.value(int_vals[index]);
+  else if (elem_type == DataObject::DOUBLE)
+    return val.value(double_vals[index]);
+  obj_vals[index] = val;
+  return true;
+}
+
+double* ArrayObject::doubles()
+{
+  return double_vals.data();
+}
+
+const double* ArrayObject::doubles() const
+{
+  return double_vals.data();
+}
+
+
+//----------------------------------------------------------------------
+// MapObject Member Functions
+//----------------------------------------------------------------------
+
+const size_t MapObject::EMPTY;
+const size_t MapObject::DELETED;
+
+MapObject::MapObject(DataObject::DataType key_type)
+  : key_type(key_type)
+{
+  rehash(8);
+}
+
+size_t MapObject::size() const
+{
+  return count;
+}
+
+size_t MapObject::hash(const DataObject& key) const
+{
+  size_t code;
+  if (key_type == DataObject::STRING) {
+    // FNV-1a over the characters (read in place)
+    const char* chars = nullptr;
+    size_t len = 0;
+    key.value(chars, len);
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < len; ++i) {
+      h ^= (unsigned char)chars[i];
+      h *= 1099511628211ull;
+    }
+    code = (size_t)(h ^ (h >> 32));
+  }
+  else {
+    // Fibonacci hashing spreads consecutive ints over the table
+    int val = 0;
+    key.value(val);
+    uint64_t h = (uint64_t)(uint32_t)val * 11400714819323198485ull;
+    code = (size_t)(h >> 16);
+  }
+  return code < 2 ? code + 2 : code;
+}
+
+size_t MapObject::find(const DataObject& key, size_t code) const
+{
+  size_t mask = hashes.size() - 1;
+  for (size_t i = code & mask; hashes[i] != EMPTY; i = (i + 1) & mask) {
+    if (hashes[i] != code)
+      continue;
+    if (key_type == DataObject::STRING) {
+      const char* chars = nullptr;
+      size_t len = 0;
+      key.value(chars, len);
+      if (str_keys[i].size() == len && str_keys[i].compare(0, len, chars, len) == 0)
+        return i;
+    }
+    else {
+      int val = 0;
+      key.value(val);
+      if (int_keys[i] == val)
+        return i;
+    }
+  }
+  return hashes.size();
+}
+
+void MapObject::insert(size_t code, const DataObject& key, const DataObject& val)
+{
+  size_t mask = hashes.size() - 1;
+  size_t i = code & mask;
+  while (hashes[i] != EMPTY && hashes[i] != DELETED)
+    i = (i + 1) & mask;
+  if (hashes[i] == EMPTY)
+    ++used;
+  hashes[i] = code;
+  if (key_type == DataObject::STRING)
+    key.value(str_keys[i]);
+  else
+    key.value(int_keys[i]);
+  vals[i] = val;
+  ++count;
+}
+
+void MapObject::rehash(size_t slots)
+{
+  std::vector<size_t> old_hashes(slots, EMPTY);
+  std::vector<int> old_int_keys;
+  std::vector<std::string> old_str_keys;
+  std::vector<DataObject> old_vals(slots);
+  hashes.swap(old_hashes);
+  vals.swap(old_vals);
+  if (key_type == DataObject::STRING) {
+    old_str_keys.resize(slots);
+    str_keys.swap(old_str_keys);
+  }
+  else {
+    old_int_keys.resize(slots);
+    int_keys.swap(old_int_keys);
+  }
+  count = 0;
+  used = 0;
+  size_t mask = hashes.size() - 1;
+  for (size_t j = 0; j < old_hashes.size(); ++j) {
+    if (old_hashes[j] == EMPTY || old_hashes[j] == DELETED)
+      continue;
+    // the old keys are already unique, so just find a free slot
+    size_t i = old_hashes[j] & mask;
+    while (hashes[i] != EMPTY)
+      i = (i + 1) & mask;
+    hashes[i] = old_hashes[j];
+    if (key_type == DataObject::STRING)
+      str_keys[i].swap(old_str_keys[j]);
+    else
+      int_keys[i] = old_int_keys[j];
+    vals[i] = old_vals[j];
+    ++count;
+    ++used;
+  }
+}
+
+bool MapObject::get(const DataObject& key, DataObject& val) const
+{
+  size_t i = find(key, hash(key));
+  if (i == hashes.size())
+    return false;
+  val = vals[i];
+  return true;
+}
+
+bool MapObject::has(const DataObject& key) const
+{
+  return find(key, hash(key)) != hashes.size();
+}
+
+void MapObject::put(const DataObject& key, const DataObject& val)
+{
+  size_t code = hash(key);
+  size_t i = find(key, code);
+  if (i != hashes.size()) {
+    vals[i] = val;
+    return;
+  }
+  // keep the table at most 3/4 full (counting deleted slots)
+  if ((used + 1) * 4 > hashes.size() * 3)
+    rehash(count * 2 >= hashes.size() / 2 ? hashes.size() * 2 : hashes.size());
+  insert(code, key, val);
+}
+
+bool MapObject::remove(const DataObject& key)
+{
+  size_t i = find(key, hash(key));
+  if (i == hashes.size())
+    return false;
+  hashes[i] = DELETED;
+  vals[i] = DataObject();
+  if (key_type == DataObject::STRING)
+    std::string().swap(str_keys[i]);
+  --count;
+  return true;
+}
+
+
+//----------------------------------------------------------------------
+// PQueueObject Member Functions
+//----------------------------------------------------------------------
+
+size_t PQueueObject::size() const
+{
+  return entries.size();
+}
+
+bool PQueueObject::before(size_t i, size_t j) const
+{
+  if (entries[i].priority != entries[j].priority)
+    return entries[i].priority < entries[j].priority;
+  return entries[i].order < entries[j].order;
+}
+
+void PQueueObject::swap(size_t i, size_t j)
+{
+  std::swap(entries[i].priority, entries[j].priority);
+  std::swap(entries[i].order, entries[j].order);
+  entries[i].val.swap(entries[j].val);
+}
+
+void PQueueObject::push(double priority, const DataObject& val)
+{
+  entries.push_back(Entry {priority, pushed++, val});
+  // sift up
+  size_t i = entries.size() - 1;
+  while (i > 0 && before(i, (i - 1) / 2)) {
+    swap(i, (i - 1) / 2);
+    i = (i - 1) / 2;
+  }
+}
+
+void PQueueObject::peek(DataObject& val) const
+{
+  val = entries.front().val;
+}
+
+void PQueueObject::pop(DataObject& val)
+{
+  val = entries.front().val;
+  swap(0, entries.size() - 1);
+  entries.pop_back();
+  // sift down
+  size_t i = 0;
+  size_t n = entries.size();
+  while (true) {
+    size_t least = i;
+    size_t left = 2 * i + 1;
+    size_t right = left + 1;
+    if (left < n && before(left, least))
+      least = left;
+    if (right < n && before(right, least))
+      least = right;
+    if (least == i)
+      break;
+    swap(i, least);
+    i = least;
+  }
+}
+
+
+//----------------------------------------------------------------------
+// TaskObject Member Functions
+//----------------------------------------------------------------------
+
+bool TaskObject::done() const
+{
+  return finished;
+}
+
+void TaskObject::finish(const DataObject& val)
+{
+  value = val;
+  finished = true;
+}
+
+void TaskObject::fail(std::exception_ptr error)
+{
+  this->error = error;
+  finished = true;
+}
+
+void TaskObject::result(DataObject& val) const
+{
+  if (error)
+    std::rethrow_exception(error);
+  val = value;
+}
+
+
 //----------------------------------------------------------------------
 // Heap Member Functions
 //----------------------------------------------------------------------
 
+size_t Heap::new_oid()
+{
+  return next_oid++;
+}
+
+
+void Heap::set_concurrent(bool on)
+{
+  concurrent = on;
+}
+
+
+std::unique_lock<std::mutex> Heap::lock_contents(const void* contents) const
+{
+  if (!concurrent)
+    return std::unique_lock<std::mutex>();
+  // objects are at least 16 bytes apart
+  size_t i = ((uintptr_t)contents >> 4) % CONTENTS_LOCKS;
+  return std::unique_lock<std::mutex>(contents_locks[i]);
+}
+
+
+void Heap::set_max_cells(size_t cells)
+{
+  max_cells = cells;
+}
+
+
+bool Heap::has_max_cells() const
+{
+  return max_cells > 0;
+}
+
+
+bool Heap::reserve(size_t cells)
+{
+  if (max_cells == 0)
+    return true;
+  size_t used = used_cells.fetch_add(cells);
+  if (used + cells > max_cells || used + cells < used) {
+    used_cells -= cells;
+    return false;
+  }
+  return true;
+}
+
+
+void Heap::release(size_t cells)
+{
+  if (max_cells == 0)
+    return;
+  used_cells -= cells;
+}
+
+
+std::unique_lock<std::mutex> Heap::guard() const
+{
+  if (concurrent)
+    return std::unique_lock<std::mutex>(heap_lock);
+  return std::unique_lock<std::mutex>();
+}
+
+
 void Heap::set_obj(size_t oid, const HeapObject& obj)
 {
+  std::unique_lock<std::mutex> lock = guard();
   heap_objs[oid] = obj;
 }
 
 
 bool Heap::has_obj(size_t oid) const
 {
+  std::unique_lock<std::mutex> lock = guard();
   return heap_objs.count(oid) > 0;
 }
 
 
 bool Heap::get_obj(size_t oid, HeapObject& obj) const
 {
-  if (!has_obj(oid))
+  std::unique_lock<std::mutex> lock = guard();
+  auto it = heap_objs.find(oid);
+  if (it == heap_objs.end())
     return false;
-  obj = heap_objs.at(oid);
+  obj = it->second;
   return true;
 }
 
 
+HeapObject* Heap::obj_ptr(size_t oid)
+{
+  std::unique_lock<std::mutex> lock = guard();
+  auto it = heap_objs.find(oid);
+  if (it == heap_objs.end())
+    return nullptr;
+  return &it->second;
+}
+
+
+void Heap::set_array(size_t oid, const ArrayObject& obj)
+{
+  std::unique_lock<std::mutex> lock = guard();
+  heap_arrays[oid] = obj;
+}
+
+
+ArrayObject* Heap::array_ptr(size_t oid)
+{
+  std::unique_lock<std::mutex> lock = guard();
+  auto it = heap_arrays.find(oid);
+  if (it == heap_arrays.end())
+    return nullptr;
+  return &it->second;
+}
+
+
+void Heap::set_map(size_t oid, const MapObject& obj)
+{
+  std::unique_lock<std::mutex> lock = guard();
+  heap_maps[oid] = obj;
+}
+
+
+MapObject* Heap::map_ptr(size_t oid)
+{
+  std::unique_lock<std::mutex> lock = guard();
+  auto it = heap_maps.find(oid);
+  if (it == heap_maps.end())
+    return nullptr;
+  return &it->second;
+}
+
+
+void Heap::set_pqueue(size_t oid, const PQueueObject& obj)
+{
+  std::unique_lock<std::mutex> lock = guard();
+  heap_pqueues[oid] = obj;
+}
+
+
+PQueueObject* Heap::pqueue_ptr(size_t oid)
+{
+  std::unique_lock<std::mutex> lock = guard();
+  auto it = heap_pqueues.find(oid);
+  if (it == heap_pqueues.end())
+    return nullptr;
+  return &it->second;
+}
+
+
+TaskObject* Heap::new_task(size_t oid)
+{
+  std::unique_lock<std::mutex> lock = guard();
+  return &heap_tasks[oid];
+}
+
+
+TaskObject* Heap::task_ptr(size_t oid)
+{
+  std::unique_lock<std::mutex> lock = guard();
+  auto it = heap_tasks.find(oid);
+  if (it == heap_tasks.end())
+    return nullptr;
+  return &it->second;
+}
+
+
 #endif
@@ -5,75 +5,304 @@
 // DESC: HW-3 driver program for testing the parser.
 //----------------------------------------------------------------------
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <iterator>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <utility>
+#include <vector>
 #include "token.h"
 #include "mypl_exception.h"
 #include "lexer.h"
 #include "parser.h"
 #include "ast.h"
 #include "type_checker.h"
+#include "escape_analysis.h"
 #include "interpreter.h"
+#include "batch_runner.h"
+#include "ast_cache.h"
+#include "repl_session.h"
+#include "instrumentation.h"
+#include "perf_counters.h"
+#include "phase_timer.h"
+#include "ast_size.h"
 
 using namespace std;
 
 
+// run the scripts named in a list file, e.g., mypl --batch jobs.txt
+int run_batch(const char* list_path, const BatchRunner::Options& options)
+{
+  vector<string> paths;
+  if (!BatchRunner::read_list(list_path, paths)) {
+    cerr << "cannot open " << list_path << endl;
+    return 1;
+  }
+  size_t threads = ThreadPool::default_size();
+  auto start = chrono::steady_clock::now();
+  vector<BatchRunner::Result> results = BatchRunner::run(paths, threads, options);
+  double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  // each script's output, in list order
+  int failed = 0;
+  for (const BatchRunner::Result& r : results) {
+    cout << "==> " << r.path << " (exit " << r.exit_code << ")\n" << r.output;
+    if (r.exit_code != 0)
+      ++failed;
+  }
+  cerr << "batch: " << results.size() << " scripts (" << failed << " failed) in "
+       << secs << " s on " << threads << " threads, "
+       << (secs > 0 ? results.size() / secs : 0) << " scripts/s" << endl;
+  return failed > 0 ? 1 : 0;
+}
+
+
+// the tools watching a run (see instrumentation.h)
+struct Tools
+{
+  const char* profile_path = nullptr;
+  const char* trace_path = nullptr;
+  size_t trace_buffer = 1 << 20;
+  const char* coverage_path = nullptr;
+  bool stats = false;
+  bool time_phases = false;
+
+  // with --stats, the hardware counters of each phase
+  std::unique_ptr<PerfCounters> counters;
+
+  // with --stats or --time-phases, the measurements of each phase
+  std::vector<Phase> phases;
+
+  // the program's file (for the coverage report)
+  const char* source_path = nullptr;
+
+  bool any() const
+  {
+    return profile_path != nullptr || trace_path != nullptr || stats;
+  }
+};
+
+
+// the peak size of a symbol table (as a phase detail)
+string symbol_table_peak(const SymbolTable& table)
+{
+  return "symbol table peak: " + to_string(table.peak_names()) + " names in " +
+    to_string(table.peak_environments()) + " environments";
+}
+
+
+// compile the program one phase at a time, measuring each phase
+// (lexing is timed in a separate pass, and taken out of the parse,
+// which lexes as it goes)
+void compile_in_phases(const string& source, Program& program, Tools& tools)
+{
+  PerfCounters* counters = tools.counters.get();
+  Phase lex;
+  {
+    PhaseTimer timer(counters);
+    istringstream input(source);
+    Lexer lexer(input);
+    size_t tokens = 1;
+    while (lexer.next_token().type() != EOS)
+      ++tokens;
+    lex = timer.read("lex", to_string(tokens) + " tokens");
+  }
+  PhaseTimer parse_timer(counters);
+  istringstream input(source);
+  Lexer lexer(input);
+  Parser parser(lexer);
+  parser.parse(program);
+  Phase parse = parse_timer.read("parse");
+  // (the separate lex pass can be the slower one for tiny programs)
+  parse.ms = max(0.0, parse.ms - lex.ms);
+  parse.counters = parse.counters - lex.counters;
+  AstSize size;
+  program.accept(size);
+  parse.detail = to_string(size.nodes) + " AST nodes, " + to_string(size.bytes) + " AST bytes";
+  PhaseTimer check_timer(counters);
+  TypeChecker type_checker;
+  program.accept(type_checker);
+  EscapeAnalysis escape_analysis;
+  program.accept(escape_analysis);
+  Phase check = check_timer.read("typecheck", symbol_table_peak(type_checker.symbol_table()));
+  tools.phases.push_back(lex);
+  tools.phases.push_back(parse);
+  tools.phases.push_back(check);
+}
+
+
+// run a compiled program with the given instrumentation, and report
+// what the tools found (while the interpreter, whose calls the trace
+// refers to, still exists)
+template<typename Policy>
+int run_program(Program& program, const BatchRunner::Options& options, Tools& tools)
+{
+  BasicInterpreter<Policy> interpreter;
+  interpreter.set_max_steps(options.max_steps);
+  interpreter.set_max_heap(options.max_heap);
+  if (tools.trace_path != nullptr)
+    Tracer::start(tools.trace_buffer);
+  // count only what running the program does
+  Stats::reset();
+  if (tools.profile_path != nullptr && !Profiler::start())
+    cerr << "could not start the profiler" << endl;
+  int status = 0;
+  PhaseTimer timer(tools.counters.get());
+  try {
+    program.accept(interpreter);
+    status = interpreter.return_code();
+  } catch (MyPLException& e) {
+    cout << e.to_string() << endl;
+    status = 1;
+  }
+  if (tools.stats || tools.time_phases)
+    tools.phases.push_back(timer.read("interpret", symbol_table_peak(interpreter.symbol_table())));
+  if (tools.profile_path != nullptr)
+    Profiler::stop();
+  if (tools.trace_path != nullptr) {
+    Tracer::stop();
+    ofstream trace(tools.trace_path);
+    Tracer::write_json(trace);
+  }
+  if (tools.stats) {
+    Stats::report(cerr);
+    cerr << "hardware counters:\n";
+    if (!tools.counters -> available())
+      cerr << "  unavailable (perf_event_open failed)\n";
+    else {
+      PerfCounters::header(cerr);
+      for (Phase& phase : tools.phases)
+        PerfCounters::row(cerr, phase.name, phase.counters);
+    }
+  }
+  if (tools.time_phases)
+    PhaseTimer::report(cerr, tools.phases);
+  if (tools.coverage_path != nullptr) {
+    ofstream coverage(tools.coverage_path);
+    Coverage::write_lcov(coverage, program, tools.source_path);
+  }
+  if (tools.profile_path != nullptr) {
+    ofstream folded(tools.profile_path);
+    Profiler::write_folded(folded);
+    Profiler::report(cerr);
+  }
+  return status;
+}
+
+
+// parse an option's count (digits only, at most max); returns false
+// for anything else, e.g., "abc", "-5", or a value that overflows
+bool parse_count(const char* text, unsigned long long max, unsigned long long& count)
+{
+  if (!isdigit((unsigned char)text[0]))
+    return false;
+  char* end = nullptr;
+  errno = 0;
+  count = strtoull(text, &end, 10);
+  return *end == '\0' && errno != ERANGE && count <= max;
+}
+
+
 int main(int argc, char* argv[])
 {
-  istream* input_stream = &cin;
+  // options come first:
+  //   --no-cache        always lex, parse, and check the program
+  //   --max-steps N     stop after N loop iterations and calls
+  //   --max-heap N      stop when the heap would exceed N cells
+  //   --profile FILE    sample the program, writing its folded stacks
+  //                     to FILE and a summary to stderr
+  //   --trace=FILE      write every call's start and end time to FILE
+  //                     (as Chrome trace-event JSON)
+  //   --trace-buffer=N  keep only the last N calls (default 1048576)
+  //   --coverage=FILE   write each line's execution count to FILE (as
+  //                     an lcov tracefile)
+  //   --stats           print interpreter statistics to stderr
+  //   --time-phases     print the time and memory of each phase (lex,
+  //                     parse, typecheck, interpret) to stderr
+  BatchRunner::Options options;
+  Tools tools;
+  int first = 1;
+  unsigned long long count;
+  while (first < argc && strncmp(argv[first], "--", 2) == 0 && strcmp(argv[first], "--batch") != 0) {
+    if (strcmp(argv[first], "--no-cache") == 0)
+      options.use_cache = false;
+    else if (strcmp(argv[first], "--max-steps") == 0 && first + 1 < argc) {
+      if (!parse_count(argv[++first], LLONG_MAX, count)) {
+        cerr << "invalid --max-steps " << argv[first] << " (expected a count)" << endl;
+        return 1;
+      }
+      options.max_steps = count;
+    }
+    else if (strcmp(argv[first], "--max-heap") == 0 && first + 1 < argc) {
+      if (!parse_count(argv[++first], SIZE_MAX, count)) {
+        cerr << "invalid --max-heap " << argv[first] << " (expected a count)" << endl;
+        return 1;
+      }
+      options.max_heap = count;
+    }
+    else if (strcmp(argv[first], "--profile") == 0 && first + 1 < argc)
+      tools.profile_path = argv[++first];
+    else if (strcmp(argv[first], "--stats") == 0)
+      tools.stats = true;
+    else if (strcmp(argv[first], "--time-phases") == 0)
+      tools.time_phases = true;
+    else if (strncmp(argv[first], "--trace=", 8) == 0)
+      tools.trace_path = argv[first] + 8;
+    else if (strncmp(argv[first], "--trace-buffer=", 15) == 0) {
+      if (!parse_count(argv[first] + 15, SIZE_MAX, count)) {
+        cerr << "invalid " << argv[first] << " (expected a count)" << endl;
+        return 1;
+      }
+      tools.trace_buffer = count;
+    }
+    else if (strncmp(argv[first], "--coverage=", 11) == 0)
+      tools.coverage_path = argv[first] + 11;
+    else {
+      cerr << "unknown option " << argv[first] << endl;
+      return 1;
+    }
+    ++first;
+  }
+  argc -= first - 1;
+  argv += first - 1;
+  if (argc == 3 && strcmp(argv[1], "--batch") == 0)
+    return run_batch(argv[2], options);
   if (argc == 2) { //file session
-    cout << "we in";
-    input_stream = new ifstream(argv[1]);
-    // create the lexer
-    Lexer lexer(*input_stream);
-    Parser parser(lexer);
-    // read each token in the file until EOS or error
-    Interpreter interpreter;
+    ifstream file(argv[1]);
+    string source((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    Program ast_root_node;
     try {
-      Program ast_root_node;
-      parser.parse(ast_root_node);
-      TypeChecker type_checker;
-      ast_root_node.accept(type_checker);
-      ast_root_node.accept(interpreter);
-    } catch (MyPLException e) {
+      // --stats and --time-phases measure each phase, so they
+      // always compile
+      if (tools.stats || tools.time_phases) {
+        if (tools.stats)
+          tools.counters.reset(new PerfCounters);
+        compile_in_phases(source, ast_root_node, tools);
+      }
+      else
+        AstCache::compile(source, ast_root_node, options.use_cache);
+    } catch (MyPLException& e) {
       cout << e.to_string() << endl;
-      exit(1);
+      return 1;
     }
-    // clean up the input stream
-    if (input_stream != &cin)
-      delete input_stream;
-    return interpreter.return_code();
+    // the tools need an instrumented interpreter (which also counts
+    // coverage), and coverage alone only needs its own hook
+    tools.source_path = argv[1];
+    if (tools.any())
+      return run_program<Instrumented>(ast_root_node, options, tools);
+    if (tools.coverage_path != nullptr)
+      return run_program<Covered>(ast_root_node, options, tools);
+    return run_program<NoInstrumentation>(ast_root_node, options, tools);
   }
 
   //Go into REPL session if no input file given
-
-  else { // in REPL session
-    // create the lexer
-    Lexer lexer(*input_stream);
-    Parser parser(lexer);
-    // make a bunch of repl Nodes
-    // loop through those nodes, just loop until EOS trust the lexer and parser will be in right spot
-    //   parse through the node
-    //   type check the node
-    //   interpret the node
-    // read each token in the file until EOS or error
-    Interpreter interpreter;
-    while(parser.eof_found == false) {
-      try {
-        Repl repl_node;
-        parser.parse(repl_node);
-        TypeChecker type_checker;
-        repl_node.accept(type_checker);
-        repl_node.accept(interpreter);
-      } catch (MyPLException e) {
-        cout << e.to_string() << endl;
-        exit(1);
-      }
-    }
-      // clean up the input stream
-    if (input_stream != &cin)
-      delete input_stream;
-    return interpreter.return_code();
-  }
+  ReplSession session;
+  return session.run();
 }
-
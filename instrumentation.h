@@ -0,0 +1,132 @@
+//----------------------------------------------------------------------
+// NAME: Charles Walker
+// FILE: instrumentation.h
+// DATE: Spring 2021
+// DESC: Instrumentation policies for the interpreter. BasicInterpreter
+//       (interpreter.h) takes a policy type and calls its static hooks
+//       when it is created and destroyed, enters and leaves an AST
+//       node, runs a statement, evaluates a call expression, enters
+//       and leaves a function, calls a built-in, creates a heap or call
+//       frame object, and pushes or pops an environment. NoInstrumentation's hooks are
+//       empty and compile away, so the plain Interpreter pays nothing
+//       for them. Instrumented feeds the statistics (stats.h), the
+//       profiler's shadow stacks (profiler.h), call tracing
+//       (tracer.h), and line coverage (coverage.h), and Covered only
+//       line coverage. A new tool is a new policy, e.g.:
+//
+//         struct CountCalls : NoInstrumentation {
+//           static void fun_enter(const FunDecl* fun) {++calls;}
+//         };
+//         BasicInterpreter<CountCalls> interpreter;
+//----------------------------------------------------------------------
+
+
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include "ast.h"
+#include "stats.h"
+#include "profiler.h"
+#include "tracer.h"
+#include "coverage.h"
+
+
+// no instrumentation (every hook does nothing)
+struct NoInstrumentation
+{
+  // an interpreter (or task runner) created and destroyed
+  static void start() {}
+  static void stop() {}
+
+  // entering and leaving a node (leaving is also called on an error)
+  static void node_enter(Stats::Node kind) {}
+  static void node_exit(Stats::Node kind) {}
+
+  // a statement about to be run
+  static void stmt(const Stmt& node) {}
+
+  // a call expression (built-in or user-defined) is evaluated between
+  // call_enter and call_exit, which gets call_enter's result
+  static long long call_enter(const CallExpr& node) {return 0;}
+  static void call_exit(const CallExpr& node, long long enter, bool user) {}
+
+  // a call of a user-defined function (nullptr for a parfor chunk)
+  static void fun_enter(const FunDecl* fun) {}
+  static void fun_exit() {}
+
+  // a built-in function call
+  static void builtin(Stats::Builtin fun) {}
+
+  // an object created in the heap or in a call frame
+  static void heap_alloc() {}
+  static void frame_alloc() {}
+
+  // an environment pushed or popped
+  static void env_push() {}
+  static void env_pop() {}
+};
+
+
+// statistics, profiling, tracing, and coverage (profiling and tracing
+// only record while they are turned on)
+struct Instrumented
+{
+  static void start() {++Stats::data_counters;}
+  static void stop() {--Stats::data_counters;}
+  static void node_enter(Stats::Node kind) {Stats::visit(kind);}
+  static void node_exit(Stats::Node kind) {}
+  static void stmt(const Stmt& node)
+  {
+    Profiler::stack.at(&node);
+    Coverage::hit(node);
+  }
+  static long long call_enter(const CallExpr& node) {return Tracer::call_start();}
+  static void call_exit(const CallExpr& node, long long enter, bool user)
+  {
+    Tracer::call_end(node, enter, user);
+  }
+  static void fun_enter(const FunDecl* fun) {Profiler::stack.push(fun);}
+  static void fun_exit() {Profiler::stack.pop();}
+  static void builtin(Stats::Builtin fun) {Stats::call(fun);}
+  static void heap_alloc() {++Stats::local.heap_objects;}
+  static void frame_alloc() {++Stats::local.frame_objects;}
+  static void env_push() {++Stats::local.env_pushes;}
+  static void env_pop() {++Stats::local.env_pops;}
+};
+
+
+// line coverage only
+struct Covered : NoInstrumentation
+{
+  static void stmt(const Stmt& node) {Coverage::hit(node);}
+};
+
+
+// calls node_enter now and node_exit when it goes out of scope
+template<typename Policy>
+class NodeHook
+{
+public:
+  NodeHook(Stats::Node kind) : kind(kind) {Policy::node_enter(kind);}
+  ~NodeHook() {Policy::node_exit(kind);}
+private:
+  Stats::Node kind;
+};
+
+
+// calls call_enter now and call_exit when it goes out of scope
+template<typename Policy>
+class CallHook
+{
+public:
+  CallHook(const CallExpr& node) : node(node), enter(Policy::call_enter(node)) {}
+  ~CallHook() {Policy::call_exit(node, enter, user);}
+  // set for calls of user-defined functions
+  bool user = false;
+private:
+  const CallExpr& node;
+  long long enter;
+};
+
+
+#endif
@@ -2,7 +2,7 @@
 // NAME: Charles Walker
 // FILE: interpreter.h
 // DATE: 4/15/2021
-// DESC: interpreter for MYPL 
+// DESC: interpreter for MYPL
 //----------------------------------------------------------------------
 
 
@@ -10,18 +10,40 @@
 #define INTERPRETER_H
 
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <unordered_map>
-#include <regex>
+#include <vector>
 #include "ast.h"
 #include "symbol_table.h"
 #include "data_object.h"
 #include "heap.h"
+#include "string_kernels.h"
+#include "vec_kernels.h"
+#include "thread_pool.h"
+#include "instrumentation.h"
 
 
-class Interpreter : public Visitor
+template<typename Policy>
+class BasicInterpreter : public Visitor
 {
 public:
 
+  // an interpreter printing to out and reading from in
+  BasicInterpreter(std::ostream& out = std::cout, std::istream& in = std::cin);
+
+  // waits for spawned tasks that were never joined
+  ~BasicInterpreter();
+
+  // wait for the spawned tasks still running (e.g., ones main never
+  // joined) and stop the pool's threads (a later spawn starts them
+  // again)
+  void finish_tasks();
+
   // top-level
   void visit(Program& node);
   void visit(FunDecl& node);
@@ -35,6 +57,7 @@ public:
   void visit(IfStmt& node);
   void visit(WhileStmt& node);
   void visit(ForStmt& node);
+  void visit(ParForStmt& node);
   // expressions
   void visit(Expr& node);
   void visit(SimpleTerm& node);
@@ -45,610 +68,1158 @@ public:
   void visit(CallExpr& node);
   void visit(IDRValue& node);
   void visit(NegatedRValue& node);
+  void visit(ArrayRValue& node);
+  void visit(SpawnRValue& node);
 
   // return code from calling main
   int return_code() const;
 
-  
+  // the symbol table (e.g., for its peak size)
+  const SymbolTable& symbol_table() const;
+
+  // declare the program's functions and types without running main
+  // (the global environment is kept for later calls)
+  void load(Program& node);
+
+  // call a function of a loaded program with the given arguments and
+  // return its result
+  DataObject call(const std::string& name, std::list<DataObject> args);
+
+  // limit the number of steps (loop iterations and calls) the program
+  // may take (0 for no limit); each call starts a new count
+  void set_max_steps(long long steps);
+
+  // limit the size of the heap in cells (0 for no limit, see heap.h)
+  void set_max_heap(size_t cells);
+
+
 private:
 
-  // return exception
-  class MyPLReturnException : public std::exception {};
-  
-  // the symbol table 
+  // the program's output and input (workers use their parent's)
+  std::ostream& out;
+  std::istream& in;
+
+  // held while printing or reading (the root's is shared by its workers)
+  std::mutex io_lock;
+
+  // the symbol table
   SymbolTable sym_table;
 
   // holds the previously computed value
   DataObject curr_val;
 
-  // the heap
-  Heap heap;
+  // the heap (parfor workers use their parent's heap)
+  Heap own_heap;
+  Heap& heap;
+
+  // objects that do not escape the call that created them (see
+  // escape_analysis.h) live on this stack instead of the heap, and
+  // are released when the call returns. Their oids are tagged with
+  // FRAME_OID_BIT and hold the object's index in the stack.
+  std::vector<HeapObject> frame_objs;
+  // the heap cells counted for each of them (see reserve)
+  std::vector<size_t> frame_obj_cells;
+  static const size_t FRAME_OID_BIT = ((size_t)1) << (sizeof(size_t) * 8 - 1);
+
+  // number of active user-defined function calls
+  int call_depth = 0;
+
+  // set by a return stmt (statement lists stop running) until the
+  // call returns
+  bool returning = false;
+
+  // the steps the program has left (on the root). Each interpreter
+  // takes steps from it in batches and counts them down in
+  // steps_left, so the shared count is rarely touched.
+  std::atomic<long long> fuel {LLONG_MAX};
+  long long steps_left = 0;
+  static const long long STEP_BATCH = 4096;
 
-  // the next oid
-  size_t next_oid = 0;
-  
   // the functions (all within the global environment)
   std::unordered_map<std::string,FunDecl*> functions;
-  
+
   // the user-defined types (all within the global environment)
   std::unordered_map<std::string,TypeDecl*> types;
 
   // the global environment id
   int global_env_id = 0;
-  
+
+  // true once a repl session has pushed its global environment
+  bool in_repl = false;
+
   // the program return code
   int ret_code = 0;
 
+  // the call of main (kept for traces, which refer to their calls)
+  CallExpr main_call;
+
+  // the interpreter that started the program (this one, unless this
+  // is a worker running parfor iterations or spawned tasks for it)
+  BasicInterpreter* root = this;
+
+  // true if this interpreter is a worker
+  bool worker = false;
+
+  // the threads running parfor loops and spawned tasks (started by
+  // the first one), and the interpreter running tasks on each thread
+  // (only used by the root)
+  std::unique_ptr<ThreadPool> pool;
+  std::vector<std::unique_ptr<BasicInterpreter>> task_runners;
+
+  // a worker, sharing the heap and declarations of the parent
+  BasicInterpreter(BasicInterpreter& parent);
+
+  // start the thread pool (on the root)
+  void start_pool();
+
+  // run the iterations first..last of a parfor loop (on a worker)
+  void parfor_range(ParForStmt& node, int first, int last);
+
+  // run a spawned call on the current thread's task runner (on the root)
+  void run_task(FunDecl* fun, const std::list<DataObject>& args, TaskObject* task);
+
+  // call a user-defined function (the result is left in curr_val)
+  void call_function(FunDecl& fun, std::list<DataObject>& args);
+
+  // push or pop an environment of the symbol table
+  void push_env();
+  void pop_env();
+
+  // a new heap object id
+  size_t new_oid();
+
+  // take a batch of steps from the root (an error if none are left)
+  void refuel(const Token& token);
+
+  // account for new heap cells (an error if the heap is full)
+  void reserve(size_t cells, const Token& token);
+
+  // release the frame objects from mark on, and their heap cells
+  void pop_frame_objs(size_t mark);
+
+  // the string with its \n and \t escapes replaced (for printing)
+  std::string unescape(const std::string& str) const;
+
+  // the object referenced by the given value (heap or frame)
+  HeapObject* get_obj(const DataObject& ref, const Token& token);
+
+  // the object holding the last attribute of a path (e.g., x.y.z)
+  HeapObject* path_obj(const std::list<Token>& path);
+
+  // the value of a variable or path
+  void path_val(const std::list<Token>& path, DataObject& val);
+
+  // the array referenced by the given value
+  ArrayObject* get_array(const DataObject& ref, const Token& token);
+
+  // the map referenced by the given value
+  MapObject* get_map(const DataObject& ref, const Token& token);
+
+  // the priority queue referenced by the given value
+  PQueueObject* get_pqueue(const DataObject& ref, const Token& token);
+
+  // put a new array of size copies of init on the heap, returning its
+  // oid (a runtime error if there is no memory for it)
+  size_t new_array(DataObject::DataType elem_type, size_t size, const DataObject& init,
+                   const Token& token);
+
+  // evaluate the indexes into the referenced array, each but the last
+  // giving the (nested) array of the next one, checking their bounds;
+  // returns the innermost array and its index in i
+  ArrayObject* index_array(const DataObject& ref, const std::list<Expr*>& indices,
+                           const Token& token, size_t& i);
+
+  // the expressions on the left of the expressions being evaluated
+  // (see left_spine in ast.h), innermost last
+  std::vector<Expr*> spine;
+
+  // finish evaluating the expression, given the value of its first
+  // term in curr_val (applies its not or its operator)
+  void apply(Expr& node);
+
+  // evaluate a whole-vector operator (one operand may be a double)
+  void vec_op(Expr& node, const DataObject& lhs, const DataObject& rhs);
+
+  // true if the expression (or term) is a +, -, or * whose result, if
+  // a vec, is a fresh temporary
+  bool fresh_vec(Expr* expr) const;
+  bool fresh_vec(ExprTerm* term) const;
+
+  // evaluate a comparison operator
+  template<typename T>
+  bool compare(TokenType op, const T& lval, const T& rval) const;
+
   // error message
   void error(const std::string& msg, const Token& token);
-  void error(const std::string& msg); 
+  void error(const std::string& msg);
 };
 
 
+// the interpreter without instrumentation
+typedef BasicInterpreter<NoInstrumentation> Interpreter;
+
+
+
+template<typename Policy>
+BasicInterpreter<Policy>::BasicInterpreter(std::ostream& out, std::istream& in)
+  : out(out), in(in), heap(own_heap)
+{
+  Policy::start();
+}
+
+
+template<typename Policy>
+BasicInterpreter<Policy>::BasicInterpreter(BasicInterpreter& parent)
+  : out(parent.out), in(parent.in), heap(parent.heap),
+    functions(parent.functions), types(parent.types),
+    root(parent.root), worker(true)
+{
+  Policy::start();
+  push_env();
+  global_env_id = sym_table.get_environment_id();
+}
+
+
+template<typename Policy>
+BasicInterpreter<Policy>::~BasicInterpreter()
+{
+  // tasks still running use the task runners (and the heap), so they
+  // finish before any member is destroyed
+  finish_tasks();
+  Policy::stop();
+}
+
+
+template<typename Policy>
+void BasicInterpreter<Policy>::finish_tasks()
+{
+  if (!pool)
+    return;
+  // the threads read pool until they are joined
+  pool -> stop();
+  pool.reset();
+  task_runners.clear();
+}
+
+
+template<typename Policy>
+void BasicInterpreter<Policy>::set_max_steps(long long steps)
+{
+  fuel = steps > 0 ? steps : LLONG_MAX;
+  steps_left = 0;
+}
+
+
+template<typename Policy>
+void BasicInterpreter<Policy>::set_max_heap(size_t cells)
+{
+  heap.set_max_cells(cells);
+}
+
+
+template<typename Policy>
+void BasicInterpreter<Policy>::push_env()
+{
+  Policy::env_push();
+  sym_table.push_environment();
+}
+
+
+template<typename Policy>
+void BasicInterpreter<Policy>::pop_env()
+{
+  Policy::env_pop();
+  sym_table.pop_environment();
+}
+
+
+template<typename Policy>
+size_t BasicInterpreter<Policy>::new_oid()
+{
+  Policy::heap_alloc();
+  return heap.new_oid();
+}
+
+
+template<typename Policy>
+void BasicInterpreter<Policy>::refuel(const Token& token)
+{
+  long long left = root -> fuel.fetch_sub(STEP_BATCH);
+  if (left <= 0)
+    error("step limit exceeded", token);
+  // one of the steps is the one being taken
+  steps_left = (left < STEP_BATCH ? left : STEP_BATCH) - 1;
+}
+
+
+template<typename Policy>
+void BasicInterpreter<Policy>::reserve(size_t cells, const Token& token)
+{
+  if (!heap.reserve(cells))
+    error("heap limit exceeded", token);
+}
+
 
-int Interpreter::return_code() const
+template<typename Policy>
+void BasicInterpreter<Policy>::pop_frame_objs(size_t mark)
+{
+  size_t cells = 0;
+  for (size_t i = mark; i < frame_obj_cells.size(); ++i)
+    cells += frame_obj_cells[i];
+  heap.release(cells);
+  frame_objs.resize(mark);
+  frame_obj_cells.resize(mark);
+}
+
+
+template<typename Policy>
+void BasicInterpreter<Policy>::start_pool()
+{
+  pool.reset(new ThreadPool(ThreadPool::default_size()));
+  task_runners.resize(pool -> size());
+  // from now on other threads may use the heap and share strings
+  if (pool -> size() > 1)
+  {
+    heap.set_concurrent(true);
+    DataObject::set_threaded(true);
+  }
+}
+
+
+template<typename Policy>
+void BasicInterpreter<Policy>::run_task(FunDecl* fun, const std::list<DataObject>& args, TaskObject* task)
+{
+  // each thread has its own runner; a runner waiting on a join runs
+  // other tasks like nested calls
+  std::unique_ptr<BasicInterpreter>& runner = task_runners[pool -> worker_id()];
+  if (!runner)
+    runner.reset(new BasicInterpreter(*this));
+  std::list<DataObject> call_args = args;
+  try {
+    runner -> call_function(*fun, call_args);
+    task -> finish(runner -> curr_val);
+  }
+  catch (...) {
+    task -> fail(std::current_exception());
+  }
+}
+
+
+template<typename Policy>
+int BasicInterpreter<Policy>::return_code() const
 {
   return ret_code;
 }
 
-void Interpreter::error(const std::string& msg, const Token& token)
+template<typename Policy>
+const SymbolTable& BasicInterpreter<Policy>::symbol_table() const
+{
+  return sym_table;
+}
+
+template<typename Policy>
+void BasicInterpreter<Policy>::error(const std::string& msg, const Token& token)
 {
   throw MyPLException(RUNTIME, msg, token.line(), token.column());
 }
 
 
-void Interpreter::error(const std::string& msg)
+template<typename Policy>
+void BasicInterpreter<Policy>::error(const std::string& msg)
 {
   throw MyPLException(RUNTIME, msg);
 }
 
 
-//----------------------------------------------------------------------
-// Function, Variable, and Type Declarations
-//----------------------------------------------------------------------
-void Interpreter::visit(Repl& node)
+template<typename Policy>
+HeapObject* BasicInterpreter<Policy>::get_obj(const DataObject& ref, const Token& token)
 {
-  sym_table.push_environment();
-  global_env_id = sym_table.get_environment_id();
-  std::list<Stmt*> stmts = node.stmts;
-  while (stmts.size() != 0)
+  size_t oid;
+  if (!ref.value(oid))
+    error("nil reference", token);
+  if (oid & FRAME_OID_BIT)
+    return &frame_objs[oid & ~FRAME_OID_BIT];
+  HeapObject* obj = heap.obj_ptr(oid);
+  if (obj == nullptr)
+    error("invalid object reference", token);
+  return obj;
+}
+
+
+template<typename Policy>
+HeapObject* BasicInterpreter<Policy>::path_obj(const std::list<Token>& path)
+{
+  auto it = path.begin();
+  DataObject info;
+  sym_table.get_val_info(it->lexeme(), info);
+  HeapObject* obj = get_obj(info, *it);
+  // follow the attributes up to the last one
+  for (++it; std::next(it) != path.end(); ++it)
   {
-    stmts.front() -> accept(*this);
-    stmts.pop_front();
+    {
+      std::unique_lock<std::mutex> lock = heap.lock_contents(obj);
+      obj->get_val(it->lexeme(), info);
+    }
+    obj = get_obj(info, *it);
   }
-  sym_table.pop_environment();
+  return obj;
 }
 
-void Interpreter::visit(Program& node)
+
+template<typename Policy>
+void BasicInterpreter<Policy>::path_val(const std::list<Token>& path, DataObject& val)
 {
-  sym_table.push_environment();
-  global_env_id = sym_table.get_environment_id();
-  for (Decl * d: node.decls)
-    d -> accept(*this);
-  CallExpr expr;
-  expr.function_id = functions["main"] -> id;
-  expr.accept(*this);
-  sym_table.pop_environment();
+  if (path.size() > 1)
+  {
+    HeapObject* h_obj = path_obj(path);
+    std::unique_lock<std::mutex> lock = heap.lock_contents(h_obj);
+    if (h_obj -> has_att(path.back().lexeme()))
+      h_obj -> get_val(path.back().lexeme(), val);
+  }
+  else if (sym_table.has_val_info(path.front().lexeme()))
+    sym_table.get_val_info(path.front().lexeme(), val);
 }
 
-void Interpreter::visit(FunDecl& node)
+
+template<typename Policy>
+ArrayObject* BasicInterpreter<Policy>::get_array(const DataObject& ref, const Token& token)
 {
-  FunDecl * temp = new FunDecl;
-  *temp = node;
-  functions[node.id.lexeme()] = temp;
-  temp = nullptr;
+  size_t oid;
+  if (!ref.value(oid))
+    error("nil reference", token);
+  ArrayObject* arr = heap.array_ptr(oid);
+  if (arr == nullptr)
+    error("invalid array reference", token);
+  return arr;
 }
 
-void Interpreter::visit(TypeDecl& node)
+
+template<typename Policy>
+bool BasicInterpreter<Policy>::fresh_vec(Expr* expr) const
 {
-  TypeDecl * temp;
-  *temp = node;
-  types[node.id.lexeme()] = temp;
-  temp = nullptr;
+  if (expr -> negated)
+    return false;
+  if (expr -> op == nullptr)
+    return fresh_vec(expr -> first);
+  TokenType op = expr -> op -> type();
+  return op == PLUS || op == MINUS || op == MULTIPLY;
 }
 
-void Interpreter::visit(ReplEndpoint& node)
+
+template<typename Policy>
+bool BasicInterpreter<Policy>::fresh_vec(ExprTerm* term) const
 {
-  // Repl* temp = new Repl;
-  // *temp = node;
-  // functions[node.id.lexeme()] = temp;
-  // temp = nullptr;
+  ComplexTerm* complex = dynamic_cast<ComplexTerm*>(term);
+  return complex != nullptr && fresh_vec(complex -> expr);
+}
+
+
+template<typename Policy>
+MapObject* BasicInterpreter<Policy>::get_map(const DataObject& ref, const Token& token)
+{
+  size_t oid;
+  if (!ref.value(oid))
+    error("nil reference", token);
+  MapObject* map = heap.map_ptr(oid);
+  if (map == nullptr)
+    error("invalid map reference", token);
+  return map;
 }
 
-void Interpreter::visit(VarDeclStmt& node)
+
+template<typename Policy>
+PQueueObject* BasicInterpreter<Policy>::get_pqueue(const DataObject& ref, const Token& token)
 {
-  node.expr -> accept(*this);
-  //int case
-  if (curr_val.is_integer())
-  {
-    int v;
-    curr_val.value(v);
-    DataObject obj(v);
+  size_t oid;
+  if (!ref.value(oid))
+    error("nil reference", token);
+  PQueueObject* queue = heap.pqueue_ptr(oid);
+  if (queue == nullptr)
+    error("invalid pqueue reference", token);
+  return queue;
+}
+
 
-    sym_table.add_name(node.id.lexeme());
-    sym_table.set_val_info(node.id.lexeme(), obj);
+template<typename Policy>
+void BasicInterpreter<Policy>::vec_op(Expr& node, const DataObject& lhs, const DataObject& rhs)
+{
+  const Token& token = *node.op;
+  TokenType op = token.type();
+  // a double operand scales the vec (only for *)
+  double factor = 0.0;
+  bool scaled = false;
+  ArrayObject* v;
+  ArrayObject* w = nullptr;
+  if (lhs.is_double())
+  {
+    lhs.value(factor);
+    scaled = true;
+    v = get_array(rhs, token);
   }
-  //double case
-  else if (curr_val.is_double())
+  else
   {
-    double v;
-    curr_val.value(v);
-    DataObject obj(v);
-    sym_table.add_name(node.id.lexeme());
-    sym_table.set_val_info(node.id.lexeme(), obj);
+    scaled = rhs.value(factor);
+    v = get_array(lhs, token);
+    if (!scaled)
+      w = get_array(rhs, token);
   }
-  //string case
-  else if (curr_val.is_string())
+  size_t n = v -> size();
+  if (w != nullptr && w -> size() != n)
+    error("vec lengths differ", token);
+  // an operand computed by another vec operator in this expression
+  // is not referenced anywhere else, so the result can overwrite it
+  ArrayObject* out;
+  if (lhs.is_oid() && fresh_vec(node.first))
   {
-    std::string v;
-    curr_val.value(v);
-    DataObject obj(v);
-    sym_table.add_name(node.id.lexeme());
-    sym_table.set_val_info(node.id.lexeme(), obj);
+    out = get_array(lhs, token);
+    curr_val = lhs;
   }
-  //char case
-  else if (curr_val.is_char())
+  else if (rhs.is_oid() && fresh_vec(node.rest))
   {
-    char v;
-    curr_val.value(v);
-    DataObject obj(v);
-    sym_table.add_name(node.id.lexeme());
-    sym_table.set_val_info(node.id.lexeme(), obj);
+    out = get_array(rhs, token);
+    curr_val = rhs;
   }
-  //bool case 
-  else if (curr_val.is_bool())
+  else
   {
-    bool v;
-    curr_val.value(v);
-    DataObject obj(v);
-    sym_table.add_name(node.id.lexeme());
-    sym_table.set_val_info(node.id.lexeme(), obj);
+    reserve(1 + n, token);
+    size_t oid = new_oid();
+    heap.set_array(oid, ArrayObject(DataObject::DOUBLE, n, DataObject(0.0)));
+    out = heap.array_ptr(oid);
+    curr_val.set(oid);
+  }
+  if (scaled)
+    VecKernels::scale(v -> doubles(), factor, out -> doubles(), n);
+  else
+  {
+    VecKernels::Op vop = op == PLUS ? VecKernels::ADD :
+      (op == MINUS ? VecKernels::SUB : VecKernels::MUL);
+    VecKernels::apply(vop, v -> doubles(), w -> doubles(), out -> doubles(), n);
   }
 }
 
-void Interpreter::visit(AssignStmt& node)
+
+template<typename Policy>
+size_t BasicInterpreter<Policy>::new_array(DataObject::DataType elem_type, size_t size,
+                                           const DataObject& init, const Token& token)
 {
-  node.expr -> accept(*this);
-  if (node.lvalue_list.size() > 1) // UDT attribute
+  size_t oid = new_oid();
+  try {
+    heap.set_array(oid, ArrayObject(elem_type, size, init));
+  } catch (std::bad_alloc&) {
+    error("out of memory for an array of " + std::to_string(size) + " elements", token);
+  }
+  return oid;
+}
+
+
+template<typename Policy>
+ArrayObject* BasicInterpreter<Policy>::index_array(const DataObject& ref,
+                                                   const std::list<Expr*>& indices,
+                                                   const Token& token, size_t& i)
+{
+  DataObject elem = ref;
+  ArrayObject* arr = nullptr;
+  for (Expr* index : indices)
   {
-    std::list<Token> tokens = node.lvalue_list;
-    DataObject info;
-    if (sym_table.has_val_info(tokens.front().lexeme())) {
-      // info isan oid
-      sym_table.get_val_info(tokens.front().lexeme(), info);
+    // the element indexed so far holds the next array
+    if (arr != nullptr)
+    {
+      std::unique_lock<std::mutex> lock = heap.lock_contents(arr);
+      arr -> get(i, elem);
     }
-    tokens.pop_front();
-    while (tokens.size() > 1)
+    index -> accept(*this);
+    int val = 0;
+    curr_val.value(val);
+    // look up the array after the index (which may allocate)
+    arr = get_array(elem, token);
+    if (val < 0 || (size_t)val >= arr -> size())
+      error("array index " + std::to_string(val) + " out of range", token);
+    i = val;
+  }
+  return arr;
+}
+
+
+template<typename Policy>
+std::string BasicInterpreter<Policy>::unescape(const std::string& str) const
+{
+  size_t i = StringKernels::find_char(str.data(), str.size(), '\\');
+  if (i == StringKernels::npos)
+    return str;
+  std::string result = str.substr(0, i);
+  for (; i < str.size(); ++i)
+  {
+    if (str[i] == '\\' && i + 1 < str.size() && (str[i+1] == 'n' || str[i+1] == 't'))
     {
-      HeapObject h_obj;
-      size_t oid;
-      info.value(oid) ;
-      heap.get_obj(oid, h_obj);
-      if (h_obj.has_att(tokens.front() .lexeme())) {
-        h_obj.get_val(tokens.front().lexeme(), info);
-      }
-      tokens.pop_front();
+      result += str[i+1] == 'n' ? '\n' : '\t';
+      ++i;
     }
+    else
+      result += str[i];
+  }
+  return result;
+}
+
 
-    HeapObject h_obj;
-    size_t oid;
-    info.value(oid);
-    heap.get_obj(oid, h_obj);
-    if (h_obj.has_att(tokens.front().lexeme()))
-      h_obj.set_att(tokens.front().lexeme(), curr_val);
+template<typename Policy>
+template<typename T>
+bool BasicInterpreter<Policy>::compare(TokenType op, const T& lval, const T& rval) const
+{
+  switch (op)
+  {
+    case EQUAL: return lval == rval;
+    case NOT_EQUAL: return lval != rval;
+    case LESS: return lval < rval;
+    case LESS_EQUAL: return lval <= rval;
+    case GREATER: return lval > rval;
+    case GREATER_EQUAL: return lval >= rval;
+    default: return false;
+  }
+}
+
+
+//----------------------------------------------------------------------
+// Function, Variable, and Type Declarations
+//----------------------------------------------------------------------
+template<typename Policy>
+void BasicInterpreter<Policy>::visit(Repl& node)
+{
+  NodeHook<Policy> hook(Stats::REPL);
+  // the global environment is kept across the inputs of a session
+  if (!in_repl)
+  {
+    push_env();
+    global_env_id = sym_table.get_environment_id();
+    in_repl = true;
+  }
+  for (Decl* d : node.decls)
+    d -> accept(*this);
+  try
+  {
+    for (Stmt* s : node.stmts)
+      s -> accept(*this);
+  }
+  catch (...)
+  {
+    // drop the block environments of the failed statement
+    while (sym_table.get_environment_id() != global_env_id)
+      pop_env();
+    throw;
+  }
+}
+
+template<typename Policy>
+void BasicInterpreter<Policy>::load(Program& node)
+{
+  push_env();
+  global_env_id = sym_table.get_environment_id();
+  for (Decl * d: node.decls)
+    d -> accept(*this);
+}
+
+template<typename Policy>
+DataObject BasicInterpreter<Policy>::call(const std::string& name, std::list<DataObject> args)
+{
+  auto fun = functions.find(name);
+  if (fun == functions.end())
+    error("function does not exist: " + name);
+  if (args.size() != fun -> second -> params.size())
+    error(name + " requires " + std::to_string(fun -> second -> params.size()) +
+          " arguments, got " + std::to_string(args.size()));
+  call_function(*fun -> second, args);
+  return curr_val;
+}
+
+template<typename Policy>
+void BasicInterpreter<Policy>::visit(Program& node)
+{
+  NodeHook<Policy> hook(Stats::PROGRAM);
+  load(node);
+  main_call.function_id = functions["main"] -> id;
+  main_call.accept(*this);
+  // main's return value is the program return code
+  int val;
+  if (curr_val.value(val))
+    ret_code = val;
+  // the program ends once the tasks it spawned do
+  finish_tasks();
+  pop_env();
+}
+
+template<typename Policy>
+void BasicInterpreter<Policy>::visit(FunDecl& node)
+{
+  NodeHook<Policy> hook(Stats::FUN_DECL);
+  functions[node.id.lexeme()] = &node;
+}
+
+template<typename Policy>
+void BasicInterpreter<Policy>::visit(TypeDecl& node)
+{
+  NodeHook<Policy> hook(Stats::TYPE_DECL);
+  types[node.id.lexeme()] = &node;
+}
+
+template<typename Policy>
+void BasicInterpreter<Policy>::visit(ReplEndpoint& node)
+{
+  NodeHook<Policy> hook(Stats::REPL_ENDPOINT);
+  // Repl* temp = new Repl;
+  // *temp = node;
+  // functions[node.id.lexeme()] = temp;
+  // temp = nullptr;
+}
+
+template<typename Policy>
+void BasicInterpreter<Policy>::visit(VarDeclStmt& node)
+{
+  NodeHook<Policy> hook(Stats::VAR_DECL_STMT);
+  Policy::stmt(node);
+  node.expr -> accept(*this);
+  sym_table.add_name(node.id.lexeme());
+  sym_table.set_val_info(node.id.lexeme(), curr_val);
+}
+
+template<typename Policy>
+void BasicInterpreter<Policy>::visit(AssignStmt& node)
+{
+  NodeHook<Policy> hook(Stats::ASSIGN_STMT);
+  Policy::stmt(node);
+  node.expr -> accept(*this);
+  if (!node.indices.empty()) // array element
+  {
+    DataObject val = curr_val;
+    DataObject ref;
+    path_val(node.lvalue_list, ref);
+    size_t i;
+    ArrayObject* arr = index_array(ref, node.indices, node.lvalue_list.back(), i);
+    std::unique_lock<std::mutex> lock = heap.lock_contents(arr);
+    if (!arr -> set(i, val))
+      error("cannot store nil in a numeric array", node.lvalue_list.back());
+    curr_val = val;
+  }
+  else if (node.lvalue_list.size() > 1) // UDT attribute
+  {
+    HeapObject* h_obj = path_obj(node.lvalue_list);
+    std::unique_lock<std::mutex> lock = heap.lock_contents(h_obj);
+    h_obj -> set_att(node.lvalue_list.back().lexeme(), curr_val);
   }
   else
     sym_table.set_val_info(node.lvalue_list.front().lexeme(), curr_val);
 }
 
-void Interpreter::visit(ReturnStmt& node)
+template<typename Policy>
+void BasicInterpreter<Policy>::visit(ReturnStmt& node)
 {
-    node.expr -> accept(*this);
-    std::string str = curr_val.to_string();
-    str = std::regex_replace(str, std::regex("\\\\n"), "\n");
-    str = std::regex_replace(str, std::regex("\\\\t"), "\t");
-    std::cout <<">>>" << str << "\n";
-    // throw new MyPLReturnException;
+  NodeHook<Policy> hook(Stats::RETURN_STMT);
+  Policy::stmt(node);
+  node.expr -> accept(*this);
+  // return from the current function call
+  if (call_depth > 0)
+  {
+    returning = true;
+    return;
+  }
+  // in the repl, a return displays the value
+  out <<">>>" << unescape(curr_val.to_string()) << "\n";
 }
 
-void Interpreter::visit(IfStmt& node)
+template<typename Policy>
+void BasicInterpreter<Policy>::visit(IfStmt& node)
 {
+  NodeHook<Policy> hook(Stats::IF_STMT);
+  Policy::stmt(node);
   node.if_part -> expr -> accept(*this) ;
-  bool entered = false;
-  bool v;
+  bool v = false;
   curr_val.value(v);
-  if (v == true)
-  {
-    
-    sym_table.push_environment();
-    std::list<Stmt*> stmts = node.if_part -> stmts;
-    while (stmts.size() != 0)
-    {
-      stmts.front() -> accept(*this);
-      stmts.pop_front();
-    }
-    entered = true;
-    sym_table.pop_environment();
-  }
+  std::list<Stmt*>* body = nullptr;
+  if (v)
+    body = &node.if_part -> stmts;
   // else ifs
-  else if (node.else_ifs.size() > 0)
-  {
-    std::list<BasicIf*> elseif_list = node.else_ifs;
-    while (entered == false & elseif_list.size() != 0) 
-    { 
-      BasicIf* if_stmt = elseif_list.front();
-      if_stmt -> expr -> accept(*this);
-      curr_val.value(v);
-      if (v == true)
-      {
-        sym_table.push_environment();
-        std::list<Stmt*> stmts = if_stmt -> stmts;
-        while (stmts.size() != 0)
-        {
-          stmts.front() -> accept(*this);
-          stmts.pop_front();
-        }
-        entered = true;
-        sym_table.pop_environment();
-      }
-    }
+  for (auto it = node.else_ifs.begin(); body == nullptr && it != node.else_ifs.end(); ++it)
+  {
+    (*it) -> expr -> accept(*this);
+    v = false;
+    curr_val.value(v);
+    if (v)
+      body = &(*it) -> stmts;
   }
   // else part
-  if (entered == false && node.body_stmts.size() != 0)
+  if (body == nullptr)
+    body = &node.body_stmts;
+  push_env();
+  for (Stmt* s : *body)
   {
-    sym_table.push_environment();
-    std::list<Stmt*> stmts = node.body_stmts;
-    while (stmts.size() != 9)
-    {
-      stmts.front() -> accept(*this);
-      stmts.pop_front();
-    }
-    sym_table.pop_environment();
+    s -> accept(*this);
+    if (returning)
+      break;
   }
+  pop_env();
 }
 
-void Interpreter::visit(WhileStmt& node)
+template<typename Policy>
+void BasicInterpreter<Policy>::visit(WhileStmt& node)
 {
+  NodeHook<Policy> hook(Stats::WHILE_STMT);
+  Policy::stmt(node);
   node.expr -> accept(*this);
-  bool v;
+  bool v = false;
   curr_val.value(v);
-  sym_table.push_environment();
+  push_env();
   while (v == true)
   {
-    std::list<Stmt*> stmts = node.stmts;
-    while (stmts.size() != 0)
+    if (--steps_left < 0)
+      refuel(node.expr -> first_token());
+    for (Stmt* s : node.stmts)
     {
-      stmts.front() -> accept(*this);
-      stmts.pop_front();
+      s -> accept(*this);
+      if (returning)
+        break;
     }
+    if (returning)
+      break;
+    Policy::stmt(node);
     node.expr -> accept(*this);
     curr_val.value(v);
   }
-  sym_table.pop_environment();
+  pop_env();
 }
 
-void Interpreter::visit(ForStmt& node)
+template<typename Policy>
+void BasicInterpreter<Policy>::visit(ForStmt& node)
 {
-  sym_table.push_environment();
+  NodeHook<Policy> hook(Stats::FOR_STMT);
+  Policy::stmt(node);
+  push_env();
   node.start -> accept(*this);
   int num;
   curr_val.value(num);
   int start_val = num;
-  DataObject obj(curr_val);
 
   sym_table.add_name(node.var_id.lexeme());
-  sym_table.set_val_info(node.var_id.lexeme(), obj);
+  sym_table.set_val_info(node.var_id.lexeme(), curr_val);
   node.end -> accept(*this);
 
   curr_val.value(num);
   int end_val = num;
   // go through loop
-  sym_table.push_environment();
-  for (int i = start_val; i <= end_val; ++i)
+  push_env();
+  for (int i = start_val; i <= end_val && !returning; ++i)
   {
-    std::list<Stmt*> stmts = node.stmts;
-    while (stmts.size() != 0)
+    if (--steps_left < 0)
+      refuel(node.var_id);
+    sym_table.set_val_info(node.var_id.lexeme(), DataObject(i));
+    for (Stmt* s : node.stmts)
     {
-      stmts.front() -> accept(*this);
-      stmts.pop_front();
+      s -> accept(*this);
+      if (returning)
+        break;
     }
   }
-  sym_table.pop_environment();
-  sym_table.pop_environment();
+  pop_env();
+  pop_env();
 }
 
-void Interpreter::visit(Expr& node)
+template<typename Policy>
+void BasicInterpreter<Policy>::visit(ParForStmt& node)
+{
+  NodeHook<Policy> hook(Stats::PARFOR_STMT);
+  // parfors reached from a parfor body run sequentially
+  if (worker)
+  {
+    visit(static_cast<ForStmt&>(node));
+    return;
+  }
+  Policy::stmt(node);
+  push_env();
+  node.start -> accept(*this);
+  int start_val = 0;
+  curr_val.value(start_val);
+  sym_table.add_name(node.var_id.lexeme());
+  sym_table.set_val_info(node.var_id.lexeme(), curr_val);
+  node.end -> accept(*this);
+  int end_val = 0;
+  curr_val.value(end_val);
+  if (end_val < start_val)
+  {
+    pop_env();
+    return;
+  }
+  pop_env();
+  if (!pool)
+    start_pool();
+  // several chunks per worker so idle workers have work to steal
+  long long count = (long long)end_val - start_val + 1;
+  int chunk = std::max(1LL, count / (long long)(pool -> size() * 8));
+  pool -> run(start_val, end_val, chunk, [&](int first, int last) {
+    // each chunk gets its own copy of the variables (the type checker
+    // rejects writes to them)
+    BasicInterpreter chunk_worker(*this);
+    chunk_worker.push_env();
+    sym_table.copy_vals(chunk_worker.sym_table);
+    chunk_worker.call_depth = call_depth;
+    chunk_worker.parfor_range(node, first, last);
+  });
+}
+
+template<typename Policy>
+void BasicInterpreter<Policy>::parfor_range(ParForStmt& node, int first, int last)
+{
+  push_env();
+  sym_table.add_name(node.var_id.lexeme());
+  push_env();
+  size_t frame_mark = frame_objs.size();
+  // the chunk shows up in profiles as a call of "parfor" (the parfor
+  // statement itself was already counted once, by visit(ParForStmt))
+  Policy::fun_enter(nullptr);
+  try {
+    for (int i = first; i <= last; ++i)
+    {
+      if (--steps_left < 0)
+        refuel(node.var_id);
+      sym_table.set_val_info(node.var_id.lexeme(), DataObject(i));
+      for (Stmt* s : node.stmts)
+        s -> accept(*this);
+      // objects created by the iteration cannot outlive it
+      pop_frame_objs(frame_mark);
+    }
+  }
+  catch (...) {
+    pop_frame_objs(frame_mark);
+    Policy::fun_exit();
+    throw;
+  }
+  Policy::fun_exit();
+  pop_env();
+  pop_env();
+}
+
+template<typename Policy>
+void BasicInterpreter<Policy>::visit(Expr& node)
+{
+  NodeHook<Policy> hook(Stats::EXPR);
+  node.first -> accept(*this);
+  apply(node);
+}
+
+template<typename Policy>
+void BasicInterpreter<Policy>::apply(Expr& node)
 {
   if (node.negated)
   {
-    node.first -> accept(*this);
     bool val;
     curr_val.value(val);
     curr_val.set(!val);
+    return;
   }
-  else
+  if (node.op == nullptr)
+    return;
+  TokenType op = node.op -> type();
+  // and/or skip the right operand once the left one decides the value
+  // (false and ..., true or ...), which is then already curr_val
+  if (op == AND || op == OR)
   {
-    node.first -> accept(*this);
-    if (node.op != nullptr)
+    bool lval;
+    curr_val.value(lval);
+    if (lval == (op == OR))
+      return;
+  }
+  DataObject lhs_val = curr_val;
+  node.rest -> accept(*this);
+  DataObject rhs_val = curr_val;
+  //  Cases for operand
+  switch (op)
+  {
+    //case for == != < <= > >=
+    case EQUAL: case NOT_EQUAL: case LESS_EQUAL: case GREATER_EQUAL: case LESS: case GREATER:
     {
-      DataObject lhs_val = curr_val;
-      node.rest -> accept(*this);
-      DataObject rhs_val = curr_val;
-      //  Cases for operand
-      switch (node.op->type())
+      // nil is only equal to nil
+      if (lhs_val.is_nil() || rhs_val.is_nil())
+      {
+        bool same = lhs_val.is_nil() && rhs_val.is_nil();
+        curr_val.set(op == EQUAL ? same : !same);
+      }
+      else if (lhs_val.is_integer())
+      {
+        int lval, rval;
+        lhs_val.value(lval);
+        rhs_val.value(rval);
+        curr_val.set(compare(op, lval, rval));
+      }
+      else if (lhs_val.is_double())
       {
-        //case for == !=
-        case EQUAL: case NOT_EQUAL: case LESS_EQUAL: case GREATER_EQUAL: case LESS: case GREATER:
-        {
-          if (lhs_val.is_integer())
-          {
-            int lval;
-            int rval;
-            lhs_val.value(lval);
-            rhs_val.value(rval);
-            if(EQUAL) {
-              DataObject obj(lval == rval);
-              curr_val = obj;
-            }
-            else if (NOT_EQUAL){
-              DataObject obj(lval != rval);
-              curr_val = obj;
-            }
-            else if (LESS_EQUAL){
-              DataObject obj(lval <= rval);
-              curr_val = obj;
-            }
-            else if (GREATER_EQUAL){
-              DataObject obj(lval >= rval);
-              curr_val = obj;
-            }
-            else if (LESS){
-              DataObject obj(lval < rval);
-              curr_val = obj;
-            }
-            else if (GREATER){
-              DataObject obj(lval > rval);
-              curr_val = obj;
-            }
-          }
-          else if (lhs_val.is_double())
-          {
-            double lval;
-            double rval;
-            lhs_val.value(lval);
-            rhs_val.value(rval);
-            if(EQUAL) {
-              DataObject obj(lval == rval);
-              curr_val = obj;
-            }
-            else if (NOT_EQUAL){
-              DataObject obj(lval != rval);
-              curr_val = obj;
-            }
-            else if (LESS_EQUAL){
-              DataObject obj(lval <= rval);
-              curr_val = obj;
-            }
-            else if (GREATER_EQUAL){
-              DataObject obj(lval >= rval);
-              curr_val = obj;
-            }
-            else if (LESS){
-              DataObject obj(lval < rval);
-              curr_val = obj;
-            }
-            else if (GREATER){
-              DataObject obj(lval > rval);
-              curr_val = obj;
-            }
-          }
-          else if (lhs_val.is_bool())
-          {
-            bool lval;
-            bool rval;
-            lhs_val.value(lval);
-            rhs_val.value(rval);
-            if(EQUAL) {
-              DataObject obj(lval == rval);
-              curr_val = obj;
-            }
-            else if (NOT_EQUAL){
-              DataObject obj(lval != rval);
-              curr_val = obj;
-            }
-            else if (LESS_EQUAL){
-              DataObject obj(lval <= rval);
-              curr_val = obj;
-            }
-            else if (GREATER_EQUAL){
-              DataObject obj(lval >= rval);
-              curr_val = obj;
-            }
-            else if (LESS){
-              DataObject obj(lval < rval);
-              curr_val = obj;
-            }
-            else if (GREATER){
-              DataObject obj(lval > rval);
-              curr_val = obj;
-            }
-          }
-          else if (lhs_val.is_string())
-          {
-            std::string lval;
-            std::string rval;
-            lhs_val.value(lval);
-            rhs_val.value(rval);
-            if(EQUAL) {
-              DataObject obj(lval == rval);
-              curr_val = obj;
-            }
-            else if (NOT_EQUAL){
-              DataObject obj(lval != rval);
-              curr_val = obj;
-            }
-            else if (LESS_EQUAL){
-              DataObject obj(lval <= rval);
-              curr_val = obj;
-            }
-            else if (GREATER_EQUAL){
-              DataObject obj(lval >= rval);
-              curr_val = obj;
-            }
-            else if (LESS){
-              DataObject obj(lval < rval);
-              curr_val = obj;
-            }
-            else if (GREATER){
-              DataObject obj(lval > rval);
-              curr_val = obj;
-            }
-          }
-          else if (lhs_val.is_char())
-          {
-            char lval;
-            char rval;
-            lhs_val.value(lval);
-            rhs_val.value(rval);
-            if(EQUAL) {
-              DataObject obj(lval == rval);
-              curr_val = obj;
-            }
-            else if (NOT_EQUAL){
-              DataObject obj(lval != rval);
-              curr_val = obj;
-            }
-            else if (LESS_EQUAL){
-              DataObject obj(lval <= rval);
-              curr_val = obj;
-            }
-            else if (GREATER_EQUAL){
-              DataObject obj(lval >= rval);
-              curr_val = obj;
-            }
-            else if (LESS){
-              DataObject obj(lval < rval);
-              curr_val = obj;
-            }
-            else if (GREATER){
-              DataObject obj(lval > rval);
-              curr_val = obj;
-            }
-          }
-        }
-        //mathematical operators
-        case PLUS: case MINUS: case MULTIPLY: case DIVIDE: case MODULO:
-        {
-          if (lhs_val.is_integer())
-          {
-            int lval;
-            int rval;
-            lhs_val.value(lval);
-            rhs_val.value(rval);
-            if(PLUS)
-              curr_val.set(lval + rval);
-            else if(MINUS)
-              curr_val.set(lval - rval);
-            else if(MULTIPLY)
-              curr_val.set(lval * rval);
-            else if(DIVIDE)
-              curr_val.set(lval / rval);
-            else if(MODULO)
-              curr_val.set(lval % rval);
-          }
-          else if (lhs_val.is_double())
-          {
-            double lval;
-            double rval;
-            lhs_val.value(lval);
-            rhs_val.value(rval);
-            if(PLUS)
-              curr_val.set(lval + rval);
-            else if(MINUS)
-              curr_val.set(lval - rval);
-            else if(MULTIPLY)
-              curr_val.set(lval * rval);
-            else if(DIVIDE)
-              curr_val.set(lval / rval);
-          }
-          
-          //addition with strings and chars
-          else 
-          {
-            //char and string -> string
-            if (lhs_val.is_char() & rhs_val.is_string())
-            {
-              char lval;
-              std::string rval;
-              lhs_val.value(lval);
-              rhs_val.value(rval);
-              DataObject obj(lval + rval);
-              curr_val = obj;
-            }
-            //string and char -> string
-            else if (lhs_val.is_string() && rhs_val.is_char())
-            {
-              char rval;
-              std::string lval;
-              lhs_val.value(lval);
-              rhs_val.value(rval);
-              DataObject obj(lval + rval);
-              curr_val = obj;
-            }
-            //chars -> string
-            else if (lhs_val.is_char() && rhs_val.is_char())
-            {
-              char rval;
-              char lval;
-              lhs_val.value(lval);
-              rhs_val.value(rval);
-              DataObject obj(lval + rval);
-              curr_val = obj;
-            }
-            //strings
-            else 
-            {
-              std::string rval;
-              std::string lval;
-              lhs_val.value(lval);
-              rhs_val.value(rval);
-              DataObject obj(lval + rval);
-              curr_val = obj;
-            }
-          }
-        }
-        //case for and or 
-        case AND: case OR:
-        {
-          if(node.op->type() == AND or node.op->type() == OR) {
-            bool lval;
-            bool rval;
-            lhs_val.value(lval);
-            rhs_val.value(rval);
-            if (AND)
-              curr_val.set(lval and rval);
-            else if(OR)
-              curr_val.set(lval or rval);
-          }
-        }
+        double lval, rval;
+        lhs_val.value(lval);
+        rhs_val.value(rval);
+        curr_val.set(compare(op, lval, rval));
       }
+      else if (lhs_val.is_bool())
+      {
+        bool lval, rval;
+        lhs_val.value(lval);
+        rhs_val.value(rval);
+        curr_val.set(compare(op, lval, rval));
+      }
+      else if (lhs_val.is_string())
+      {
+        // compare in place (strings are not copied out)
+        const char* lchars;
+        const char* rchars;
+        size_t llen, rlen;
+        lhs_val.value(lchars, llen);
+        rhs_val.value(rchars, rlen);
+        // values sharing a buffer only differ by length
+        int cmp = 0;
+        if (lchars != rchars)
+          cmp = std::char_traits<char>::compare(lchars, rchars, std::min(llen, rlen));
+        if (cmp == 0)
+          cmp = (llen < rlen) ? -1 : (llen > rlen ? 1 : 0);
+        curr_val.set(compare(op, cmp, 0));
+      }
+      else if (lhs_val.is_char())
+      {
+        char lval, rval;
+        lhs_val.value(lval);
+        rhs_val.value(rval);
+        curr_val.set(compare(op, lval, rval));
+      }
+      else if (lhs_val.is_oid())
+      {
+        size_t lval, rval;
+        lhs_val.value(lval);
+        rhs_val.value(rval);
+        curr_val.set(compare(op, lval, rval));
+      }
+      break;
     }
+    //mathematical operators
+    case PLUS: case MINUS: case MULTIPLY: case DIVIDE: case MODULO:
+    {
+      if (lhs_val.is_nil() || rhs_val.is_nil())
+        error("nil reference", *node.op);
+      // the only references allowed in arithmetic are vecs
+      else if (lhs_val.is_oid() || rhs_val.is_oid())
+        vec_op(node, lhs_val, rhs_val);
+      else if (lhs_val.is_integer())
+      {
+        int lval;
+        int rval;
+        lhs_val.value(lval);
+        rhs_val.value(rval);
+        if ((op == DIVIDE || op == MODULO) && rval == 0)
+          error("division by zero", *node.op);
+        if(op == PLUS)
+          curr_val.set(lval + rval);
+        else if(op == MINUS)
+          curr_val.set(lval - rval);
+        else if(op == MULTIPLY)
+          curr_val.set(lval * rval);
+        else if(op == DIVIDE)
+          curr_val.set(lval / rval);
+        else if(op == MODULO)
+          curr_val.set(lval % rval);
+      }
+      else if (lhs_val.is_double())
+      {
+        double lval;
+        double rval;
+        lhs_val.value(lval);
+        rhs_val.value(rval);
+        if(op == PLUS)
+          curr_val.set(lval + rval);
+        else if(op == MINUS)
+          curr_val.set(lval - rval);
+        else if(op == MULTIPLY)
+          curr_val.set(lval * rval);
+        else if(op == DIVIDE)
+          curr_val.set(lval / rval);
+      }
+      //addition with strings and chars (appends to the lhs buffer)
+      else
+      {
+        if (lhs_val.is_string())
+          curr_val = lhs_val;
+        else
+          curr_val.set(lhs_val.to_string());
+        curr_val.append(rhs_val.to_string());
+      }
+      break;
+    }
+    //case for and or
+    case AND: case OR:
+    {
+      bool lval;
+      bool rval;
+      lhs_val.value(lval);
+      rhs_val.value(rval);
+      if (op == AND)
+        curr_val.set(lval and rval);
+      else
+        curr_val.set(lval or rval);
+      break;
+    }
+    default:
+      break;
   }
-  // std::cout << curr_val.to_string() << "\n";
 }
 
-void Interpreter::visit(SimpleTerm& node)
+template<typename Policy>
+void BasicInterpreter<Policy>::visit(SimpleTerm& node)
 {
+  NodeHook<Policy> hook(Stats::SIMPLE_TERM);
   node.rvalue -> accept(*this);
 }
 
-void Interpreter::visit(ComplexTerm& node)
+template<typename Policy>
+void BasicInterpreter<Policy>::visit(ComplexTerm& node)
 {
-  node.expr -> accept(*this);
+  NodeHook<Policy> hook(Stats::COMPLEX_TERM);
+  if (node.expr -> first -> term_expr() == nullptr)
+  {
+    node.expr -> accept(*this);
+    return;
+  }
+  // the expression and the ones nested on its left (as in a long a +
+  // b + c ...) are evaluated from the innermost one out, visiting each
+  // of them and the complex terms between them in turn
+  size_t base = spine.size();
+  left_spine(*node.expr, spine);
+  size_t level = spine.size();
+  Policy::node_enter(Stats::EXPR);
+  for (size_t i = base + 1; i < spine.size(); ++i)
+  {
+    Policy::node_enter(Stats::COMPLEX_TERM);
+    Policy::node_enter(Stats::EXPR);
+  }
+  try
+  {
+    spine.back() -> first -> accept(*this);
+    for (; level > base; --level)
+    {
+      apply(*spine[level - 1]);
+      Policy::node_exit(Stats::EXPR);
+      if (level - 1 > base)
+        Policy::node_exit(Stats::COMPLEX_TERM);
+    }
+  }
+  catch (...)
+  {
+    for (; level > base; --level)
+    {
+      Policy::node_exit(Stats::EXPR);
+      if (level - 1 > base)
+        Policy::node_exit(Stats::COMPLEX_TERM);
+    }
+    spine.resize(base);
+    throw;
+  }
+  spine.resize(base);
 }
 
-void Interpreter::visit(SimpleRValue& node)
+template<typename Policy>
+void BasicInterpreter<Policy>::visit(SimpleRValue& node)
 {
+  NodeHook<Policy> hook(Stats::SIMPLE_RVALUE);
   if (node.value.type() == BOOL_VAL)
   {
     if (node.value.lexeme() == "true")
@@ -667,36 +1238,121 @@ void Interpreter::visit(SimpleRValue& node)
     curr_val.set(val);
   }
   else if (node.value.type() == CHAR_VAL)
-    curr_val.set(node.value.lexeme().at(3));
+    curr_val.set(node.value.lexeme().at(0));
   else if (node.value.type() == STRING_VAL)
     curr_val.set(node.value.lexeme());
   else
     curr_val.set_nil();
 }
 
-void Interpreter::visit (NewRValue& node)
+template<typename Policy>
+void BasicInterpreter<Policy>::visit (NewRValue& node)
 {
-  DataObject obj;
-  obj.set(next_oid);
-  ++next_oid;
-  curr_val = obj;
+  NodeHook<Policy> hook(Stats::NEW_RVALUE);
+  // vec creation (all zeros)
+  if (node.vec_length != nullptr)
+  {
+    node.vec_length -> accept(*this);
+    int size = 0;
+    curr_val.value(size);
+    if (size < 0)
+      error("negative vec length", node.type_id);
+    reserve(1 + (size_t)size, node.type_id);
+    curr_val.set(new_array(DataObject::DOUBLE, size, DataObject(0.0), node.type_id));
+    return;
+  }
+  // array creation
+  if (node.array_size != nullptr)
+  {
+    node.array_size -> accept(*this);
+    int size = 0;
+    curr_val.value(size);
+    if (size < 0)
+      error("negative array size", node.type_id);
+    // elements start as the type's zero value (nil for references)
+    std::string type = node.type_id.lexeme();
+    DataObject init;
+    if (type == "int")
+      init.set(0);
+    else if (type == "double")
+      init.set(0.0);
+    else if (type == "bool")
+      init.set(false);
+    else if (type == "char")
+      init.set('\0');
+    else if (type == "string")
+      init.set("");
+    reserve(1 + (size_t)size, node.type_id);
+    curr_val.set(new_array(init.type(), size, init, node.type_id));
+    return;
+  }
+  // priority queue creation
+  if (node.type_id.type() == PQUEUE)
+  {
+    reserve(1, node.type_id);
+    size_t oid = new_oid();
+    heap.set_pqueue(oid, PQueueObject());
+    curr_val.set(oid);
+    return;
+  }
+  // map creation (keys are ints or strings)
+  if (node.type_id.type() == MAP)
+  {
+    bool string_keys = node.type_id.lexeme().compare(0, 11, "map string ") == 0;
+    reserve(1, node.type_id);
+    size_t oid = new_oid();
+    heap.set_map(oid, MapObject(string_keys ? DataObject::STRING : DataObject::INTEGER));
+    curr_val.set(oid);
+    return;
+  }
+  // initialize the attributes from the type declaration
+  HeapObject obj;
+  TypeDecl* type_node = types[node.type_id.lexeme()];
+  for (VarDeclStmt* v : type_node -> vdecls)
+  {
+    v -> expr -> accept(*this);
+    obj.set_att(v -> id.lexeme(), curr_val);
+  }
+  DataObject ref;
+  size_t cells = 1 + type_node -> vdecls.size();
+  reserve(cells, node.type_id);
+  if (node.frame_local && call_depth > 0)
+  {
+    // freed when the enclosing call returns
+    ref.set(FRAME_OID_BIT | frame_objs.size());
+    frame_objs.push_back(obj);
+    frame_obj_cells.push_back(cells);
+    Policy::frame_alloc();
+  }
+  else
+  {
+    size_t oid = new_oid();
+    heap.set_obj(oid, obj);
+    ref.set(oid);
+  }
+  curr_val = ref;
 }
 
-void Interpreter::visit(CallExpr& node)
+template<typename Policy>
+void BasicInterpreter<Policy>::visit(CallExpr& node)
 {
+  NodeHook<Policy> hook(Stats::CALL_EXPR);
+  Policy::stmt(node);
+  CallHook<Policy> call_hook(node);
   std::string fun_name = node. function_id.lexeme();
   // built-in print function
   if (fun_name == "print")
   {
+    Policy::builtin(Stats::PRINT);
     node.arg_list.front() -> accept(*this);
-    std::string str = curr_val.to_string();
-    str = std::regex_replace(str, std::regex("\\\\n"), "\n");
-    str = std::regex_replace(str, std::regex("\\\\t"), "\t");
-    std::cout << str;
+    std::string str = unescape(curr_val.to_string());
+    std::lock_guard<std::mutex> lock(root -> io_lock);
+    out << str;
   }
   //built in string to int
   else if (fun_name == "stoi")
   {
+    Policy::builtin(Stats::STOI);
     node.arg_list.front() -> accept(*this);
     std::string str;
     curr_val.value(str);
@@ -707,6 +1363,7 @@ void Interpreter::visit(CallExpr& node)
   //built in string to double
   else if (fun_name == "stod")
   {
+    Policy::builtin(Stats::STOD);
     node.arg_list.front() -> accept(*this);
     std::string str;
     curr_val.value(str);
@@ -717,125 +1374,345 @@ void Interpreter::visit(CallExpr& node)
   //built in int to string and double to string
   else if (fun_name == "itos" || fun_name == "dtos")
   {
+    Policy::builtin(fun_name == "itos" ? Stats::ITOS : Stats::DTOS);
     node.arg_list.front() -> accept(*this);
     std::string str = curr_val.to_string();
     DataObject obj(str);
     curr_val = obj;
   }
-  //built in get
+  //built in map get, put, has, and remove
+  else if (fun_name == "put" || fun_name == "has" || fun_name == "remove")
+  {
+    Policy::builtin(fun_name == "put" ? Stats::PUT : fun_name == "has" ? Stats::HAS : Stats::REMOVE);
+    std::list<Expr*>::iterator arg = node.arg_list.begin();
+    (*arg) -> accept(*this);
+    MapObject* map = get_map(curr_val, node.function_id);
+    (*++arg) -> accept(*this);
+    DataObject key = curr_val;
+    if (fun_name == "put")
+      (*++arg) -> accept(*this);
+    std::unique_lock<std::mutex> lock = heap.lock_contents(map);
+    if (fun_name == "put")
+    {
+      if (heap.has_max_cells() && !map -> has(key))
+        reserve(1, node.function_id);
+      map -> put(key, curr_val);
+      curr_val = DataObject();
+    }
+    else if (fun_name == "has")
+      curr_val.set(map -> has(key));
+    else
+    {
+      bool removed = map -> remove(key);
+      if (removed)
+        heap.release(1);
+      curr_val.set(removed);
+    }
+  }
+  //built in pqueue push, pop, and peek
+  else if (fun_name == "push" || fun_name == "pop" || fun_name == "peek")
+  {
+    Policy::builtin(fun_name == "push" ? Stats::PUSH : fun_name == "pop" ? Stats::POP : Stats::PEEK);
+    std::list<Expr*>::iterator arg = node.arg_list.begin();
+    (*arg) -> accept(*this);
+    PQueueObject* queue = get_pqueue(curr_val, node.function_id);
+    if (fun_name == "push")
+    {
+      (*++arg) -> accept(*this);
+      double priority = 0.0;
+      int int_priority;
+      if (curr_val.value(int_priority))
+        priority = int_priority;
+      else
+        curr_val.value(priority);
+      (*++arg) -> accept(*this);
+      reserve(1, node.function_id);
+      std::unique_lock<std::mutex> lock = heap.lock_contents(queue);
+      queue -> push(priority, curr_val);
+      curr_val = DataObject();
+    }
+    else
+    {
+      std::unique_lock<std::mutex> lock = heap.lock_contents(queue);
+      if (queue -> size() == 0)
+        error("empty pqueue", node.function_id);
+      else if (fun_name == "pop")
+      {
+        queue -> pop(curr_val);
+        heap.release(1);
+      }
+      else
+        queue -> peek(curr_val);
+    }
+  }
+  //built in get (string char or map value)
   else if (fun_name == "get")
   {
-    std::list<Expr*> expr_list = node.arg_list;
-    expr_list.front() -> accept(*this); // first arg is an int
+    Policy::builtin(Stats::GET);
+    std::list<Expr*>::iterator arg = node.arg_list.begin();
+    (*arg) -> accept(*this); // first arg is an int or a map
+    if (!curr_val.is_integer())
+    {
+      MapObject* map = get_map(curr_val, node.function_id);
+      (*++arg) -> accept(*this);
+      std::unique_lock<std::mutex> lock = heap.lock_contents(map);
+      if (!map -> get(curr_val, curr_val))
+        error("map key " + curr_val.to_string() + " not found", node.function_id);
+      return;
+    }
     int index;
     curr_val.value(index);
-    expr_list.pop_front();
-    expr_list.front() -> accept(*this); // next arg is a string
-    std::string str;
-    curr_val.value(str);
-    DataObject obj(str.at(index)); // char object
-    curr_val = obj;
+    (*++arg) -> accept(*this); // next arg is a string
+    const char* chars;
+    size_t len;
+    curr_val.value(chars, len);
+    if (index < 0 || index >= (int)len)
+      error("string index out of range", node.function_id);
+    curr_val.set(chars[index]); // char object
   }
   //built in length
   else if (fun_name == "length")
   {
+    Policy::builtin(Stats::LENGTH);
     node.arg_list.front() -> accept(*this);
-    std::string str;
-    curr_val.value(str);
-    DataObject obj(str.length()); // int object
-    curr_val = obj;
+    const char* chars;
+    size_t len;
+    curr_val.value(chars, len);
+    curr_val.set((int)len); // int object
+  }
+  //built in find
+  else if (fun_name == "find")
+  {
+    Policy::builtin(Stats::FIND);
+    std::list<Expr*>::iterator arg = node.arg_list.begin();
+    (*arg) -> accept(*this);
+    DataObject str = curr_val; // shares the buffer
+    (*++arg) -> accept(*this);
+    const char* chars;
+    size_t len;
+    const char* target;
+    size_t target_len;
+    str.value(chars, len);
+    curr_val.value(target, target_len);
+    size_t i = StringKernels::find(chars, len, target, target_len);
+    curr_val.set(i == StringKernels::npos ? -1 : (int)i);
+  }
+  //built in count and split_count
+  else if (fun_name == "count" || fun_name == "split_count")
+  {
+    Policy::builtin(fun_name == "count" ? Stats::COUNT : Stats::SPLIT_COUNT);
+    std::list<Expr*>::iterator arg = node.arg_list.begin();
+    (*arg) -> accept(*this);
+    DataObject str = curr_val;
+    (*++arg) -> accept(*this);
+    char c;
+    curr_val.value(c);
+    const char* chars;
+    size_t len;
+    str.value(chars, len);
+    int n = StringKernels::count_char(chars, len, c);
+    // n separators give n + 1 fields
+    curr_val.set(fun_name == "count" ? n : n + 1);
+  }
+  //built in starts_with and compare
+  else if (fun_name == "starts_with" || fun_name == "compare")
+  {
+    Policy::builtin(fun_name == "starts_with" ? Stats::STARTS_WITH : Stats::COMPARE);
+    std::list<Expr*>::iterator arg = node.arg_list.begin();
+    (*arg) -> accept(*this);
+    DataObject lhs = curr_val;
+    (*++arg) -> accept(*this);
+    const char* lhs_chars;
+    size_t lhs_len;
+    const char* rhs_chars;
+    size_t rhs_len;
+    lhs.value(lhs_chars, lhs_len);
+    curr_val.value(rhs_chars, rhs_len);
+    if (fun_name == "starts_with")
+      curr_val.set(StringKernels::starts_with(lhs_chars, lhs_len, rhs_chars, rhs_len));
+    else
+      curr_val.set(StringKernels::compare(lhs_chars, lhs_len, rhs_chars, rhs_len));
+  }
+  //built in upper and lower
+  else if (fun_name == "upper" || fun_name == "lower")
+  {
+    Policy::builtin(fun_name == "upper" ? Stats::UPPER : Stats::LOWER);
+    node.arg_list.front() -> accept(*this);
+    const char* chars;
+    size_t len;
+    curr_val.value(chars, len);
+    std::string str(len, '\0');
+    if (fun_name == "upper")
+      StringKernels::to_upper(chars, len, &str[0]);
+    else
+      StringKernels::to_lower(chars, len, &str[0]);
+    curr_val.set(str);
+  }
+  //built in vec dot product and in-place add and mul
+  else if (fun_name == "dot" || fun_name == "add" || fun_name == "mul")
+  {
+    Policy::builtin(fun_name == "dot" ? Stats::DOT : fun_name == "add" ? Stats::ADD : Stats::MUL);
+    std::list<Expr*>::iterator arg = node.arg_list.begin();
+    (*arg) -> accept(*this);
+    ArrayObject* lhs = get_array(curr_val, node.function_id);
+    (*++arg) -> accept(*this);
+    ArrayObject* rhs = get_array(curr_val, node.function_id);
+    if (lhs -> size() != rhs -> size())
+      error("vec lengths differ", node.function_id);
+    if (fun_name == "dot")
+      curr_val.set(VecKernels::dot(lhs -> doubles(), rhs -> doubles(), lhs -> size()));
+    else
+    {
+      VecKernels::Op op = fun_name == "add" ? VecKernels::ADD : VecKernels::MUL;
+      VecKernels::apply(op, lhs -> doubles(), rhs -> doubles(), lhs -> doubles(), lhs -> size());
+      curr_val = DataObject();
+    }
+  }
+  //built in vec sum and norm
+  else if (fun_name == "sum" || fun_name == "norm")
+  {
+    Policy::builtin(fun_name == "sum" ? Stats::SUM : Stats::NORM);
+    node.arg_list.front() -> accept(*this);
+    ArrayObject* v = get_array(curr_val, node.function_id);
+    if (fun_name == "sum")
+      curr_val.set(VecKernels::sum(v -> doubles(), v -> size()));
+    else
+      curr_val.set(VecKernels::norm(v -> doubles(), v -> size()));
+  }
+  //built in join (waits for a spawned task)
+  else if (fun_name == "join")
+  {
+    Policy::builtin(Stats::JOIN);
+    node.arg_list.front() -> accept(*this);
+    size_t oid = 0;
+    if (!curr_val.value(oid))
+      error("nil reference", node.function_id);
+    TaskObject* task = heap.task_ptr(oid);
+    // run other tasks while this one is not done
+    if (!task -> done())
+      root -> pool -> help_until([task] {return task -> done();});
+    task -> result(curr_val);
+  }
+  //built in array, map, and pqueue size
+  else if (fun_name == "size")
+  {
+    Policy::builtin(Stats::SIZE);
+    node.arg_list.front() -> accept(*this);
+    size_t oid = 0;
+    MapObject* map = curr_val.value(oid) ? heap.map_ptr(oid) : nullptr;
+    PQueueObject* queue = curr_val.value(oid) ? heap.pqueue_ptr(oid) : nullptr;
+    if (map != nullptr)
+    {
+      std::unique_lock<std::mutex> lock = heap.lock_contents(map);
+      curr_val.set((int)map -> size());
+    }
+    else if (queue != nullptr)
+    {
+      std::unique_lock<std::mutex> lock = heap.lock_contents(queue);
+      curr_val.set((int)queue -> size());
+    }
+    else
+      curr_val.set((int)get_array(curr_val, node.function_id) -> size());
   }
   //built in read
   else if (fun_name == "read")
   {
+    Policy::builtin(Stats::READ);
     // no args
     std::string str;
-    std::cin >> str;
+    std::lock_guard<std::mutex> lock(root -> io_lock);
+    in >> str;
     DataObject obj(str); // string object
     curr_val = obj;
   }
   //user defined function
-  else 
+  else
   {
-    std::list<Expr*> expr_list = node.arg_list;
+    call_hook.user = true;
     std::list<DataObject> args;
-    while (expr_list.size() != 0)
+    for (Expr* e : node.arg_list)
     {
-      Expr* e = expr_list.front();
-      DataObject obj = curr_val;
-      args.push_back(obj);
-      expr_list.pop_front();
+      e -> accept(*this);
+      args.push_back(curr_val);
     }
-
-    int curr_env_id = sym_table.get_environment_id();
-    sym_table.set_environment_id(global_env_id);
-    sym_table.push_environment();
-    FunDecl* fun_node = functions[fun_name];
-    for (FunDecl::FunParam param : fun_node -> params)
-    {
-      sym_table.add_name(param.id.lexeme());
-      sym_table.set_val_info(param.id.lexeme(), args.front());
-      args.pop_front();
-    }
-    try {
-      for (Stmt* stmt : fun_node -> stmts)
-        stmt -> accept(*this);
-    }
-    catch (MyPLReturnException* e) {
-      // return stmt found
-    }
-    sym_table.pop_environment();
-    sym_table.set_environment_id(curr_env_id);
+    call_function(*functions[fun_name], args);
   }
 }
 
-void Interpreter::visit(IDRValue& node)
+template<typename Policy>
+void BasicInterpreter<Policy>::call_function(FunDecl& fun, std::list<DataObject>& args)
 {
-  if (node.path.size() > 1)
+  if (--steps_left < 0)
+    refuel(fun.id);
+  Policy::fun_enter(&fun);
+  int curr_env_id = sym_table.get_environment_id();
+  sym_table.set_environment_id(global_env_id);
+  push_env();
+  for (FunDecl::FunParam param : fun.params)
   {
-  std::list<Token> path_list = node.path;
-  DataObject info;
-  if (sym_table.has_val_info(path_list.front().lexeme())){
-    sym_table.get_val_info(path_list.front().lexeme(), info);
+    sym_table.add_name(param.id.lexeme());
+    sym_table.set_val_info(param.id.lexeme(), args.front());
+    args.pop_front();
   }
-
-  path_list.pop_front();
-  while (path_list.size() > 1)
-  {
-    HeapObject h_obj;
-    size_t oid;
-    info.value(oid);
-    heap.get_obj(oid, h_obj);
-    if (h_obj.has_att(path_list.front().lexeme())) {
-      //info is oid
-      h_obj.get_val(path_list.front().lexeme(), info);
-    }
-    path_list.pop_front();
-  }
-    HeapObject h_obj;
-    size_t oid;
-    info.value(oid);
-    heap.get_obj(oid, h_obj);
-    if (h_obj.has_att(path_list.front().lexeme()))
+  int fun_env_id = sym_table.get_environment_id();
+  size_t frame_mark = frame_objs.size();
+  ++call_depth;
+  try {
+    for (Stmt* stmt : fun.stmts)
     {
-      DataObject value_info;
-      h_obj.get_val(path_list.front().lexeme(), value_info);
-      curr_val = value_info;
+      stmt -> accept(*this);
+      if (returning)
+        break;
     }
   }
-  else
+  catch (...) {
+    // leave the call before passing on the error (a task runner
+    // keeps going after a failed task)
+    while (sym_table.get_environment_id() != fun_env_id)
+      pop_env();
+    --call_depth;
+    pop_frame_objs(frame_mark);
+    pop_env();
+    sym_table.set_environment_id(curr_env_id);
+    Policy::fun_exit();
+    throw;
+  }
+  // a return stmt left its value in curr_val
+  if (!returning)
+    curr_val.set_nil();
+  returning = false;
+  // drop any nested block environments
+  while (sym_table.get_environment_id() != fun_env_id)
+    pop_env();
+  --call_depth;
+  // release the objects that did not escape the call
+  pop_frame_objs(frame_mark);
+  pop_env();
+  sym_table.set_environment_id(curr_env_id);
+  Policy::fun_exit();
+}
+
+template<typename Policy>
+void BasicInterpreter<Policy>::visit(IDRValue& node)
+{
+  NodeHook<Policy> hook(Stats::ID_RVALUE);
+  if (!node.indices.empty()) // array element
   {
-    if (sym_table.has_val_info(node.path.front().lexeme()))
-    {
-      DataObject info;
-      sym_table.get_val_info(node.path.front().lexeme(), info);
-      curr_val = info;
-    }
+    DataObject ref;
+    path_val(node.path, ref);
+    size_t i;
+    ArrayObject* arr = index_array(ref, node.indices, node.path.back(), i);
+    std::unique_lock<std::mutex> lock = heap.lock_contents(arr);
+    arr -> get(i, curr_val);
   }
+  else
+    path_val(node.path, curr_val);
 }
 
-void Interpreter::visit(NegatedRValue& node)
+template<typename Policy>
+void BasicInterpreter<Policy>::visit(NegatedRValue& node)
 {
+  NodeHook<Policy> hook(Stats::NEGATED_RVALUE);
   node.expr -> accept(*this);
   if (curr_val.is_double())
   {
@@ -851,4 +1728,51 @@ void Interpreter::visit(NegatedRValue& node)
   }
 }
 
+template<typename Policy>
+void BasicInterpreter<Policy>::visit(ArrayRValue& node)
+{
+  NodeHook<Policy> hook(Stats::ARRAY_RVALUE);
+  std::vector<DataObject> vals;
+  DataObject::DataType elem_type = DataObject::NIL;
+  for (Expr* e : node.elements)
+  {
+    e -> accept(*this);
+    if (elem_type == DataObject::NIL)
+      elem_type = curr_val.type();
+    vals.push_back(curr_val);
+  }
+  ArrayObject arr(elem_type, vals.size());
+  for (size_t i = 0; i < vals.size(); ++i)
+    if (!arr.set(i, vals[i]))
+      error("cannot store nil in a numeric array", node.bracket);
+  reserve(1 + vals.size(), node.bracket);
+  size_t oid = new_oid();
+  heap.set_array(oid, arr);
+  curr_val.set(oid);
+}
+
+template<typename Policy>
+void BasicInterpreter<Policy>::visit(SpawnRValue& node)
+{
+  NodeHook<Policy> hook(Stats::SPAWN_RVALUE);
+  std::list<DataObject> args;
+  for (Expr* e : node.call -> arg_list)
+  {
+    e -> accept(*this);
+    args.push_back(curr_val);
+  }
+  if (!root -> pool)
+    root -> start_pool();
+  // the task runs on some thread's runner (see run_task)
+  reserve(1, node.spawn);
+  size_t oid = new_oid();
+  TaskObject* task = heap.new_task(oid);
+  FunDecl* fun = functions[node.call -> function_id.lexeme()];
+  BasicInterpreter* task_root = root;
+  root -> pool -> submit([task_root, fun, args, task] {
+    task_root -> run_task(fun, args, task);
+  });
+  curr_val.set(oid);
+}
+
 #endif
@@ -73,62 +73,22 @@ Token Lexer::next_token()
   std::string lexeme = "";
   char ch = read();
   column++;
-  //checks if white space
-  while(std::isspace(ch)) {
-    if (ch == '\n') {
-      ch = read();
-      line++;
-      column = 1;
+  //skip white space and comments (a comment runs to the end of line)
+  while (std::isspace(ch) || ch == '#') {
+    if (ch == '#') {
+      while (ch != '\n' && ch != EOF)
+        ch = read();
+      continue;
     }
-    if (ch == '\r') {
-      ch = read();
+    if (ch == '\n') {
       line++;
       column = 1;
     }
-    if (ch == ' ') {
-      ch = read();
+    else if (ch == '\t')
+      column += 2;
+    else
       column++;
-    }
-    if (ch == '\t') {
-      ch = read();
-      column+= 2; 
-    }
-  }
-
-  //check for comments
-  if (ch == '#')
-  {
-    bool multiline = true;
-    while(multiline) {
-
-        while(ch != '\n') {
-          ch = read();
-        }
-        line++;
-        column = 1;
-        ch = read();
-      
-      while (std::isspace(ch))
-      {
-        if (ch == ' ')
-        {
-          ch = read();
-          column++;
-        }
-
-        if (ch == '\n')
-        {
-          ch = read();
-          line++;
-          column = 1;
-        }
-      }
-
-      if (ch != '#')
-      {
-        multiline = false;
-      }
-    }
+    ch = read();
   }
   if (ch == EOF) {
     return Token(EOS, "", line, column);
@@ -151,6 +111,12 @@ Token Lexer::next_token()
   if (ch == ':') {
     return Token(COLON, ":", line, column);
   }
+  if (ch == '[') {
+    return Token(LBRACKET, "[", line, column);
+  }
+  if (ch == ']') {
+    return Token(RBRACKET, "]", line, column);
+  }
   if (ch == '+') {
     return Token(PLUS, "+", line, column);
   }
@@ -237,7 +203,7 @@ Token Lexer::next_token()
       return Token(STRING_VAL, "", line, start_col);
     }
     while(peek() != '"') {
-      if (ch == EOS) {
+      if (ch == EOF || peek() == EOF) {
         error("missing \"", line, column);
       }
       if (isspace(ch))
@@ -260,15 +226,15 @@ Token Lexer::next_token()
     bool is_double = false;
     lexeme += ch;
 
-    while (std::isdigit(peek()) || peek() == '.')
+    while (std::isdigit(peek()) || (peek() == '.' && !is_double))
     {
+      ch = read();
+      column++;
       //  If the char is a dot, flag the lexeme as a double
       if (ch == '.')
         is_double = true;
 
       lexeme += ch;
-      ch = read();
-      column++;
     }
 
     // if (std::isalpha(peek()))
@@ -287,10 +253,7 @@ Token Lexer::next_token()
     int start_col = column;
     std::string lexeme = "";
     lexeme += ch;
-    while(!(std::isspace(peek())) && peek() != ',' && peek() != '(' && peek() != ')' 
-      && peek() != ':' && peek() != '='&& peek() != '.' && peek() != '+' && peek() != '-' 
-      && peek() != '/' && peek() != '*' && peek() != '%' && peek() != '#'
-      && peek() != '<' && peek() != '>') 
+    while(std::isalnum(peek()) || peek() == '_')
     {
       ch = read();
       lexeme += ch;
@@ -318,6 +281,9 @@ Token Lexer::next_token()
     if (lexeme == "for") {
       return Token(FOR, lexeme, line, start_col);
     }   
+    if (lexeme == "parfor") {
+      return Token(PARFOR, lexeme, line, start_col);
+    }
     if (lexeme == "to") {
       return Token(TO, lexeme, line, start_col);
     }
@@ -351,6 +317,9 @@ Token Lexer::next_token()
     if (lexeme == "new") {
       return Token(NEW, lexeme, line, start_col);
     }
+    if (lexeme == "spawn") {
+      return Token(SPAWN, lexeme, line, start_col);
+    }
     if (lexeme == "bool") {
       return Token(BOOL_TYPE, lexeme, line, start_col);
     }
@@ -366,6 +335,21 @@ Token Lexer::next_token()
     if (lexeme == "string") {
       return Token(STRING_TYPE, lexeme, line, start_col);
     }
+    if (lexeme == "array") {
+      return Token(ARRAY, lexeme, line, start_col);
+    }
+    if (lexeme == "vec") {
+      return Token(VEC, lexeme, line, start_col);
+    }
+    if (lexeme == "map") {
+      return Token(MAP, lexeme, line, start_col);
+    }
+    if (lexeme == "pqueue") {
+      return Token(PQUEUE, lexeme, line, start_col);
+    }
+    if (lexeme == "task") {
+      return Token(TASK, lexeme, line, start_col);
+    }
     if (lexeme == "nil") {
       return Token(NIL, lexeme, line, start_col);
     }
@@ -377,7 +361,9 @@ Token Lexer::next_token()
 
     return Token(EOS, "", line, start_col);
   }
-  
+
+  error("invalid symbol", line, column);
+  return Token(EOS, "", line, column);
 }
 
 
@@ -0,0 +1,162 @@
+//----------------------------------------------------------------------
+// NAME: Charles Walker
+// FILE: mypl.cpp
+// DATE: Spring 2021
+// DESC: Implementation of the libmypl host API (see mypl.h).
+//----------------------------------------------------------------------
+
+#include <sstream>
+#include <unordered_map>
+#include "mypl.h"
+#include "token.h"
+#include "mypl_exception.h"
+#include "lexer.h"
+#include "parser.h"
+#include "ast.h"
+#include "type_checker.h"
+#include "escape_analysis.h"
+#include "interpreter.h"
+
+
+struct MyPLProgram::Impl
+{
+  std::ostringstream out;
+  std::istringstream in;
+  Program program;
+  Interpreter interpreter;
+
+  // the parameter types of each function
+  std::unordered_map<std::string,std::vector<std::string>> params;
+
+  // the step limit of each call
+  long long max_steps = 0;
+
+  Impl() : interpreter(out, in) {}
+};
+
+
+namespace {
+
+  // the value as a data object (if it can be passed as the given type)
+  bool to_data_object(const MyPLValue& val, const std::string& type, DataObject& obj)
+  {
+    switch (val.type()) {
+      case MyPLValue::NIL: obj.set_nil(); return true;
+      case MyPLValue::BOOL: obj.set(val.as_bool()); return type == "bool";
+      case MyPLValue::INT: obj.set(val.as_int()); return type == "int";
+      case MyPLValue::DOUBLE: obj.set(val.as_double()); return type == "double";
+      case MyPLValue::CHAR: obj.set(val.as_char()); return type == "char";
+      case MyPLValue::STRING: obj.set(val.as_string()); return type == "string";
+    }
+    return false;
+  }
+
+  // the data object as a value (if it is primitive)
+  bool to_value(const DataObject& obj, MyPLValue& val)
+  {
+    bool b; int i; double d; char c; std::string s;
+    if (obj.is_nil())
+      val = MyPLValue();
+    else if (obj.value(b))
+      val = MyPLValue(b);
+    else if (obj.value(i))
+      val = MyPLValue(i);
+    else if (obj.value(d))
+      val = MyPLValue(d);
+    else if (obj.value(c))
+      val = MyPLValue(c);
+    else if (obj.value(s))
+      val = MyPLValue(s);
+    else
+      return false;
+    return true;
+  }
+
+}
+
+
+MyPLProgram::MyPLProgram(const std::string& source) : impl(new Impl)
+{
+  try {
+    std::istringstream input(source);
+    Lexer lexer(input);
+    Parser parser(lexer);
+    parser.parse(impl->program);
+    TypeChecker type_checker;
+    type_checker.require_main = false;
+    impl->program.accept(type_checker);
+    EscapeAnalysis escape_analysis;
+    impl->program.accept(escape_analysis);
+    impl->interpreter.load(impl->program);
+  } catch (MyPLException& e) {
+    throw MyPLError(e.to_string());
+  }
+  for (Decl* d : impl->program.decls) {
+    if (FunDecl* f = dynamic_cast<FunDecl*>(d)) {
+      std::vector<std::string>& types = impl->params[f->id.lexeme()];
+      for (FunDecl::FunParam& p : f->params)
+        types.push_back(p.type.lexeme());
+    }
+  }
+}
+
+
+MyPLProgram::~MyPLProgram()
+{
+}
+
+
+bool MyPLProgram::has_function(const std::string& name) const
+{
+  return impl->params.count(name) > 0;
+}
+
+
+MyPLValue MyPLProgram::call(const std::string& name, const std::vector<MyPLValue>& args)
+{
+  auto fun = impl->params.find(name);
+  if (fun == impl->params.end())
+    throw MyPLError("function does not exist: " + name);
+  const std::vector<std::string>& types = fun->second;
+  if (args.size() != types.size())
+    throw MyPLError(name + " requires " + std::to_string(types.size()) +
+                    " arguments, got " + std::to_string(args.size()));
+  std::list<DataObject> objs;
+  for (size_t i = 0; i < args.size(); ++i) {
+    objs.emplace_back();
+    if (!to_data_object(args[i], types[i], objs.back()))
+      throw MyPLError("argument " + std::to_string(i + 1) + " of " + name +
+                      " must be " + types[i]);
+  }
+  DataObject result;
+  try {
+    impl->interpreter.set_max_steps(impl->max_steps);
+    result = impl->interpreter.call(name, std::move(objs));
+  } catch (MyPLException& e) {
+    throw MyPLError(e.to_string());
+  }
+  MyPLValue val;
+  if (!to_value(result, val))
+    throw MyPLError(name + " returned a non-primitive value");
+  return val;
+}
+
+
+void MyPLProgram::set_max_steps(long long steps)
+{
+  impl->max_steps = steps;
+}
+
+
+void MyPLProgram::set_max_heap(size_t cells)
+{
+  impl->interpreter.set_max_heap(cells);
+}
+
+
+std::string MyPLProgram::take_output()
+{
+  std::string text = impl->out.str();
+  impl->out.str("");
+  return text;
+}
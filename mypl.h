@@ -0,0 +1,112 @@
+//----------------------------------------------------------------------
+// NAME: Charles Walker
+// FILE: mypl.h
+// DATE: Spring 2021
+// DESC: The host API of libmypl, for embedding MyPL in a C++ program
+//       (e.g., as a rules engine). A MyPLProgram is compiled once and
+//       its functions can then be called any number of times with
+//       native arguments, getting native results back. A program
+//       needs no main function; print writes to a buffer held by the
+//       program (see output) and read sees an empty input, so the
+//       host's stdin and stdout are never touched. A program is not
+//       safe to call from several threads at the same time.
+//
+//       This header is the only one a host includes; the interpreter
+//       itself is compiled into libmypl (mypl.cpp).
+//----------------------------------------------------------------------
+
+
+#ifndef MYPL_H
+#define MYPL_H
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+// a lexer, syntax, type, or runtime error in a program (or a bad call)
+class MyPLError : public std::runtime_error
+{
+public:
+  MyPLError(const std::string& msg) : std::runtime_error(msg) {}
+};
+
+
+// a value passed to or returned from a MyPL function
+class MyPLValue
+{
+public:
+
+  enum Type {NIL, BOOL, INT, DOUBLE, CHAR, STRING};
+
+  // construction
+  MyPLValue() {}
+  MyPLValue(bool val) : val_type(BOOL), bool_val(val) {}
+  MyPLValue(int val) : val_type(INT), int_val(val) {}
+  MyPLValue(double val) : val_type(DOUBLE), double_val(val) {}
+  MyPLValue(char val) : val_type(CHAR), char_val(val) {}
+  MyPLValue(const std::string& val) : val_type(STRING), string_val(val) {}
+  MyPLValue(const char* val) : val_type(STRING), string_val(val) {}
+
+  // get and check type
+  Type type() const {return val_type;}
+  bool is_nil() const {return val_type == NIL;}
+
+  // get the value (the default of the type if it has another type)
+  bool as_bool() const {return bool_val;}
+  int as_int() const {return int_val;}
+  double as_double() const {return double_val;}
+  char as_char() const {return char_val;}
+  const std::string& as_string() const {return string_val;}
+
+private:
+  Type val_type = NIL;
+  bool bool_val = false;
+  int int_val = 0;
+  double double_val = 0.0;
+  char char_val = '\0';
+  std::string string_val;
+};
+
+
+class MyPLProgram
+{
+public:
+
+  // compile the program source (throws MyPLError on an error)
+  MyPLProgram(const std::string& source);
+  ~MyPLProgram();
+
+  // true if the program declares the function
+  bool has_function(const std::string& name) const;
+
+  // call a function with the given arguments and return its result.
+  // The arguments and result must be primitive values (bool, int,
+  // double, char, or string, or nil). Throws MyPLError on a bad call
+  // or a runtime error.
+  MyPLValue call(const std::string& name, const std::vector<MyPLValue>& args = {});
+
+  // limit the steps (loop iterations and calls) each call may take;
+  // a call over the limit throws MyPLError (0 for no limit)
+  void set_max_steps(long long steps);
+
+  // limit the program's heap to the given number of cells (objects,
+  // attributes, array elements, and map and priority queue entries)
+  // over all calls (0 for no limit)
+  void set_max_heap(size_t cells);
+
+  // the text printed by the program since the last call to
+  // take_output (which clears it)
+  std::string take_output();
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl;
+
+  MyPLProgram(const MyPLProgram&) = delete;
+  MyPLProgram& operator=(const MyPLProgram&) = delete;
+};
+
+
+#endif
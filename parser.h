@@ -8,6 +8,8 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include <memory>
+#include <vector>
 #include "token.h"
 #include "mypl_exception.h"
 #include "ast.h"
@@ -22,22 +24,34 @@ public:
   // run the parser
   void parse(Program& node);
   void parse(Repl& node);
+  // skip the rest of the line after a syntax error (in the repl)
+  void recover();
 private:
   Lexer lexer;
   Token curr_token;
+  bool started = false;
   bool re_found = false;
+  int prev_line = 0;   // line of the last token read
+  int next_slot = 0;   // the next statement's coverage counter
   // helper functions
   void advance();
   void eat(TokenType t, std::string err_msg);
   void error(std::string err_msg);
-  bool is_operator(TokenType t);
-  void dtype();
+  int precedence(TokenType t);
+  Token dtype();
   // top-level
   void tdecl(TypeDecl& node);
   void fdecl(FunDecl& node);
   //expressions
   void expr(Expr& node);
+  Expr* binary_expr(int min_prec);
+  Expr* unary_expr();
+  Expr* logical_chain(Expr* first, int prec);
+  Expr* balance(std::vector<std::unique_ptr<Expr>>& operands,
+                std::vector<std::unique_ptr<Token>>& ops, size_t begin, size_t end);
+  Expr* binary(Expr* lhs, Token* op, Expr* rhs);
   void simple_term(SimpleTerm& node);
+  void call_args(CallExpr& node);
   void simple_rvalue(SimpleRValue& node);
   void new_rvalue(NewRValue& node);
   void neg_rvalue(NegatedRValue& node);
@@ -63,6 +77,7 @@ Parser::Parser(const Lexer& program_lexer) : lexer(program_lexer)
 
 void Parser::advance()
 {
+  prev_line = curr_token.line();
   curr_token = lexer.next_token();
 }
 
@@ -85,11 +100,25 @@ void Parser::error(std::string err_msg)
 }
 
 
-bool Parser::is_operator(TokenType t)
+// how tightly a binary operator binds (0 if t is not one): or, then
+// and, then comparisons, then + and -, then * / and %
+int Parser::precedence(TokenType t)
 {
-  return t == PLUS or t == MINUS or t == DIVIDE or t == MULTIPLY or
-    t == MODULO or t == AND or t == OR or t == EQUAL or t == LESS or
-    t == GREATER or t == LESS_EQUAL or t == GREATER_EQUAL or t == NOT_EQUAL;
+  switch (t) {
+    case OR:
+      return 1;
+    case AND:
+      return 2;
+    case EQUAL: case NOT_EQUAL: case LESS: case LESS_EQUAL:
+    case GREATER: case GREATER_EQUAL:
+      return 3;
+    case PLUS: case MINUS:
+      return 4;
+    case MULTIPLY: case DIVIDE: case MODULO:
+      return 5;
+    default:
+      return 0;
+  }
 }
 
 
@@ -102,11 +131,27 @@ void Parser::parse(Repl& node)
   // if(curr_token.type() == COLON){
   //   eat(COLON, "expecting colon ");
   // }
-  std::cout << "Enter statements: \n";
-  advance();
+  // the previous input stopped at the ':' ending its return (which
+  // is skipped) or at the first token of this input (which is kept)
+  if (!started || curr_token.type() == COLON)
+    advance();
+  started = true;
   while (re_found == false && curr_token.type()!= EOS)
   {
-    stmt(node.stmts, true);
+    if (curr_token.type() == TYPE)
+    {
+      TypeDecl* t = new TypeDecl();
+      node.decls.push_back(t);
+      tdecl(*t);
+    }
+    else if (curr_token.type() == FUN)
+    {
+      FunDecl* f = new FunDecl();
+      node.decls.push_back(f);
+      fdecl(*f);
+    }
+    else
+      stmt(node.stmts, true);
   }
   re_found = false;
   // std::cout << "endpoint found \n";
@@ -116,6 +161,23 @@ void Parser::parse(Repl& node)
   }
 }
 
+void Parser::recover()
+{
+  re_found = false;
+  // the error is on the line of the last token read (the current
+  // token may already be on the next line)
+  int line = prev_line;
+  while (curr_token.type() != EOS && curr_token.line() == line) {
+    try {
+      advance();
+    } catch (MyPLException& e) {
+      // the bad character was skipped
+    }
+  }
+  if (curr_token.type() == EOS)
+    eof_found = true;
+}
+
 void Parser::parse(Program& node)
 {
   advance();
@@ -153,7 +215,7 @@ void Parser::fdecl(FunDecl& node)
   if (curr_token.type() == NIL)
     eat(NIL, "expecting nil ");
   else 
-    dtype();
+    node.return_type = dtype();
   
   node.id = curr_token;
   eat(ID, "expecting ID ");
@@ -165,8 +227,7 @@ void Parser::fdecl(FunDecl& node)
     f.id = curr_token;
     advance();
     eat(COLON, "expecting colon ");
-    f.type = curr_token;
-    dtype();
+    f.type = dtype();
     node.params.push_back(f);
 
     if (curr_token.type() == COMMA) {
@@ -222,22 +283,10 @@ void Parser::stmt(std::list<Stmt*>& stmts, bool in_repl)
     eat(ID,"expecting ID ");
     if (curr_token.type() == LPAREN)
     {
-      eat(LPAREN, "Expected LPAREN ");
       CallExpr* c = new CallExpr();
       c->function_id = id;
-
-      //check for idrval
-
-      while (curr_token.type() != RPAREN)
-      {
-        Expr* e = new Expr();
-        expr(*e);
-        c->arg_list.push_back(e);
-        if (curr_token.type() == COMMA) 
-          eat(COMMA, "expecting comma ");
-      }
-      eat(RPAREN, "Expected RPAREN ");
       stmts.push_back(c);
+      call_args(*c);
     }
     else 
     {
@@ -247,6 +296,19 @@ void Parser::stmt(std::list<Stmt*>& stmts, bool in_repl)
 
       while (curr_token.type() != ASSIGN)
       {
+        // an array element (e.g., a[i][j]) ends the lhs
+        if (curr_token.type() == LBRACKET)
+        {
+          while (curr_token.type() == LBRACKET)
+          {
+            eat(LBRACKET, "Expected LBRACKET ");
+            Expr* e = new Expr();
+            a->indices.push_back(e);
+            expr(*e);
+            eat(RBRACKET, "Expected RBRACKET ");
+          }
+          break;
+        }
         eat(DOT, "Expected DOT ");
         a->lvalue_list.push_back(curr_token);
         eat(ID, "Expected ID ");
@@ -274,6 +336,11 @@ void Parser::stmt(std::list<Stmt*>& stmts, bool in_repl)
     for_stmt(*f);
     stmts.push_back(f);
   }
+  else if (curr_token.type() == PARFOR) {
+    ParForStmt* f = new ParForStmt();
+    for_stmt(*f);
+    stmts.push_back(f);
+  }
   else if (curr_token.type() == RETURN) {
     ReturnStmt* r = new ReturnStmt();
     return_stmt(*r, in_repl);
@@ -286,13 +353,14 @@ void Parser::stmt(std::list<Stmt*>& stmts, bool in_repl)
   // }
   else 
     error("unexpected token ");
+  // each statement gets its own coverage counter (see coverage.h)
+  stmts.back()->slot = next_slot++;
 }
 
 
 //repl endpoint
 void Parser::repl_endpoint(ReplEndpoint& node)
 {
-  std::cout << "endpoint found \n";
   Expr* e = new Expr();
   expr(*e);
   node.expr = e;
@@ -314,9 +382,8 @@ void Parser::vdecl_stmt(VarDeclStmt& node)
   {
     eat(COLON, "expecting colon ");
     Token* id = new Token();
-    *id = curr_token;
+    *id = dtype();
     node.type = id;
-    advance();
   }
 
   eat(ASSIGN, "expecting assign ");
@@ -436,7 +503,11 @@ void Parser::while_stmt(WhileStmt& node)
 //forstmt node
 void Parser::for_stmt(ForStmt& node)
 {
-  eat(FOR, "expecting for");
+  // parfor loops have the same form
+  if (curr_token.type() == PARFOR)
+    eat(PARFOR, "expecting parfor");
+  else
+    eat(FOR, "expecting for");
   node.var_id = curr_token;
   eat(ID, "expecting id");
   eat(ASSIGN, "expecting assign");
@@ -455,6 +526,7 @@ void Parser::for_stmt(ForStmt& node)
   {
     stmt(stmt_list);
   }
+  node.stmts = stmt_list;
   eat(END, "expecting end");
 
 }
@@ -466,56 +538,123 @@ void Parser::for_stmt(ForStmt& node)
 //expression node
 void Parser::expr(Expr& node)
 {
-  //negated case
-  if (curr_token.type() == NEG)
+  std::unique_ptr<Expr> e(binary_expr(1));
+  node.negated = e->negated;
+  node.first = e->first;
+  node.op = e->op;
+  node.rest = e->rest;
+  e->first = nullptr;
+  e->op = nullptr;
+  e->rest = nullptr;
+}
+
+// precedence climbing: an operand and then the operators binding at
+// least min_prec tightly, grouped to the left. A right operand only
+// takes tighter operators, so the recursion is bounded by the number
+// of precedence levels rather than the length of the expression.
+Expr* Parser::binary_expr(int min_prec)
+{
+  std::unique_ptr<Expr> lhs(unary_expr());
+  int prec;
+  while ((prec = precedence(curr_token.type())) >= min_prec)
   {
-    eat(NEG, "expecting neg ");
-    node.negated = true;
+    if (curr_token.type() == AND || curr_token.type() == OR)
+    {
+      lhs.reset(logical_chain(lhs.release(), prec));
+      continue;
+    }
+    std::unique_ptr<Token> op(new Token(curr_token));
+    advance();
+    Expr* rhs = binary_expr(prec + 1);
+    lhs.reset(binary(lhs.release(), op.release(), rhs));
   }
+  return lhs.release();
+}
 
-  //complex term
+// an operand: a term, a parenthesized expression, or not and its
+// operand (the whole rest of the expression, so "not a and b" is
+// "not (a and b)")
+Expr* Parser::unary_expr()
+{
+  std::unique_ptr<Expr> node(new Expr());
   if (curr_token.type() == NOT)
   {
-    ComplexTerm* c = new ComplexTerm();
     eat(NOT, "expecting not ");
-    node.negated = true;
-    Expr* e = new Expr();
-    expr(*e);
-    c->expr = e;
-    node.first = c;
+    ComplexTerm* c = new ComplexTerm();
+    node->negated = true;
+    node->first = c;
+    c->expr = binary_expr(1);
   }
   else if (curr_token.type() == LPAREN)
   {
-    //  LPAREN implies a complex stmt
-    
     eat(LPAREN, "expecting lparen ");
     ComplexTerm* c = new ComplexTerm();
-    Expr* e = new Expr();
-    expr(*e);
-    c->expr = e;
-    node.first = c;
+    node->first = c;
+    c->expr = binary_expr(1);
     if (curr_token.type() == RPAREN)
       eat(RPAREN, "expecting rparen ");
   }
   else
   {
-    //simple statement
     SimpleTerm* s = new SimpleTerm();
+    node->first = s;
     simple_term(*s);
-    node.first = s;
   }
+  return node.release();
+}
 
-  //optional operator 
-  if (is_operator(curr_token.type()))
+// a run of one logical operator (a and b and c ...) as a balanced
+// tree, so long conditions nest log n deep. The operands keep their
+// order, so the value and the operands that evaluation skips are the
+// same as grouping to the left.
+Expr* Parser::logical_chain(Expr* first, int prec)
+{
+  std::vector<std::unique_ptr<Expr>> operands;
+  std::vector<std::unique_ptr<Token>> ops;
+  operands.emplace_back(first);
+  TokenType type = curr_token.type();
+  while (curr_token.type() == type)
   {
-    Token* new_op = new Token;
-    *new_op = curr_token;
-    node.op = new_op;
+    ops.emplace_back(new Token(curr_token));
     advance();
-    Expr* e = new Expr();
-    expr(*e);
-    node.rest = e;
+    operands.emplace_back(binary_expr(prec + 1));
+  }
+  return balance(operands, ops, 0, operands.size());
+}
+
+// the tree of operands begin to end - 1 (ops[i] is between operands
+// i and i + 1)
+Expr* Parser::balance(std::vector<std::unique_ptr<Expr>>& operands,
+                      std::vector<std::unique_ptr<Token>>& ops, size_t begin, size_t end)
+{
+  if (end - begin == 1)
+    return operands[begin].release();
+  size_t mid = begin + (end - begin) / 2;
+  Expr* lhs = balance(operands, ops, begin, mid);
+  Expr* rhs = balance(operands, ops, mid, end);
+  return binary(lhs, ops[mid - 1].release(), rhs);
+}
+
+// an operator node: the left operand is the first term (wrapped in a
+// complex term unless it is a lone term) and the right one the rest
+Expr* Parser::binary(Expr* lhs, Token* op, Expr* rhs)
+{
+  Expr* node = new Expr();
+  node->op = op;
+  node->rest = rhs;
+  if (lhs->op == nullptr && !lhs->negated)
+  {
+    node->first = lhs->first;
+    lhs->first = nullptr;
+    delete lhs;
   }
+  else
+  {
+    ComplexTerm* c = new ComplexTerm();
+    c->expr = lhs;
+    node->first = c;
+  }
+  return node;
 }
 
 //simple term node
@@ -533,6 +672,24 @@ void Parser::simple_term(SimpleTerm& node)
     node.rvalue = sr;
   }
 
+  else if (curr_token.type() == LBRACKET)
+  {
+    //  ArrayRValue case (array literal)
+    ArrayRValue* a = new ArrayRValue();
+    a->bracket = curr_token;
+    eat(LBRACKET, "Expected LBRACKET ");
+    while (curr_token.type() != RBRACKET)
+    {
+      Expr* e = new Expr();
+      expr(*e);
+      a->elements.push_back(e);
+      if (curr_token.type() != RBRACKET)
+        eat(COMMA, "expecting comma ");
+    }
+    eat(RBRACKET, "Expected RBRACKET ");
+    node.rvalue = a;
+  }
+
   else if (curr_token.type() == NEW)
   {
     //  NewRValue Case
@@ -543,12 +700,42 @@ void Parser::simple_term(SimpleTerm& node)
     node.rvalue = n;
   }
   
+  else if (curr_token.type() == SPAWN)
+  {
+    //  SpawnRValue case (a call run as a task)
+    SpawnRValue* sp = new SpawnRValue();
+    node.rvalue = sp;
+    sp->spawn = curr_token;
+    eat(SPAWN, "Expected SPAWN ");
+    sp->call = new CallExpr();
+    sp->call->function_id = curr_token;
+    eat(ID, "Expected function call after spawn ");
+    call_args(*sp->call);
+  }
+
   else if (curr_token.type() == NEG)
   {
     //  NegatedRValue Case
+    //  (neg only applies to the term that follows it)
     NegatedRValue* n = new NegatedRValue();
+    eat(NEG, "expecting neg ");
     Expr* ne = new Expr();
-    expr(*ne);
+    if (curr_token.type() == LPAREN)
+    {
+      eat(LPAREN, "expecting lparen ");
+      ComplexTerm* c = new ComplexTerm();
+      Expr* e = new Expr();
+      expr(*e);
+      c->expr = e;
+      ne->first = c;
+      eat(RPAREN, "expecting rparen ");
+    }
+    else
+    {
+      SimpleTerm* s = new SimpleTerm();
+      simple_term(*s);
+      ne->first = s;
+    }
     n->expr = ne;
     node.rvalue = n;
   }
@@ -563,20 +750,10 @@ void Parser::simple_term(SimpleTerm& node)
     if (curr_token.type() == LPAREN)
     {
       //  CallExpr case
-      eat(LPAREN, "Expected LPAREN ");
       CallExpr* c = new CallExpr();
       c->function_id = new_id;
-      while (curr_token.type() != RPAREN)
-      {
-        Expr* e = new Expr();
-        expr(*e);
-        c->arg_list.push_back(e);
-        if (curr_token.type() == COMMA) 
-          eat(COMMA, "expecting comma ");
-      }
-
-      eat(RPAREN, "Expected RPAREN ");
       node.rvalue = c;
+      call_args(*c);
     }
     else
     {
@@ -590,6 +767,15 @@ void Parser::simple_term(SimpleTerm& node)
         v->path.push_back(curr_token);
         eat(ID, "Expected ID ");
       }
+      // array element (of nested arrays, e.g., a[i][j])
+      while (curr_token.type() == LBRACKET)
+      {
+        eat(LBRACKET, "Expected LBRACKET ");
+        Expr* e = new Expr();
+        v->indices.push_back(e);
+        expr(*e);
+        eat(RBRACKET, "Expected RBRACKET ");
+      }
       node.rvalue = v;
     }
   }
@@ -600,6 +786,22 @@ void Parser::simple_term(SimpleTerm& node)
 }
 
 
+//call arguments (in parentheses)
+void Parser::call_args(CallExpr& node)
+{
+  eat(LPAREN, "Expected LPAREN ");
+  while (curr_token.type() != RPAREN)
+  {
+    Expr* e = new Expr();
+    expr(*e);
+    node.arg_list.push_back(e);
+    if (curr_token.type() == COMMA) 
+      eat(COMMA, "expecting comma ");
+  }
+  eat(RPAREN, "Expected RPAREN ");
+}
+
+
 //----------------------------------------------------------------------
 // Statement nodes
 //----------------------------------------------------------------------
@@ -613,15 +815,56 @@ void Parser::simple_rvalue(SimpleRValue& node)
 //newrvalue node
 void Parser::new_rvalue(NewRValue& node)
 {
-  node.type_id = curr_token;
-  eat(ID, "expected id ");
+  node.type_id = dtype();
+  // array creation, e.g., new int[10]
+  if (curr_token.type() == LBRACKET)
+  {
+    eat(LBRACKET, "expected lbracket ");
+    node.array_size = new Expr();
+    expr(*node.array_size);
+    eat(RBRACKET, "expected rbracket ");
+  }
+  // vec creation, e.g., new vec(10)
+  else if (node.type_id.type() == VEC && curr_token.type() == LPAREN)
+  {
+    eat(LPAREN, "expected lparen ");
+    node.vec_length = new Expr();
+    expr(*node.vec_length);
+    eat(RPAREN, "expected rparen ");
+  }
+  else if (node.type_id.type() != ID && node.type_id.type() != MAP &&
+           node.type_id.type() != PQUEUE)
+    error("expected array size ");
 }
 
 
-//dtype helper funtion
-void Parser::dtype()
+//dtype helper funtion (returns the type, e.g., int or array int)
+Token Parser::dtype()
 {
-  if (curr_token.type() == INT_TYPE) {
+  Token type = curr_token;
+  if (curr_token.type() == ARRAY) {
+    eat(ARRAY, "expecting array");
+    Token elem_type = dtype();
+    return Token(ARRAY, "array " + elem_type.lexeme(), type.line(), type.column());
+  }
+  else if (curr_token.type() == TASK) {
+    // a task handle, e.g., task int (or task nil)
+    eat(TASK, "expecting task");
+    Token result_type = curr_token;
+    if (curr_token.type() == NIL)
+      eat(NIL, "expecting nil");
+    else
+      result_type = dtype();
+    return Token(TASK, "task " + result_type.lexeme(), type.line(), type.column());
+  }
+  else if (curr_token.type() == MAP || curr_token.type() == PQUEUE) {
+    eat(curr_token.type(), "expecting map or pqueue");
+    Token key_type = dtype();
+    Token val_type = dtype();
+    return Token(type.type(), type.lexeme() + " " + key_type.lexeme() + " " + val_type.lexeme(),
+                 type.line(), type.column());
+  }
+  else if (curr_token.type() == INT_TYPE) {
     eat(INT_TYPE, "expecting int_type");
   
   }
@@ -640,6 +883,10 @@ void Parser::dtype()
   else if (curr_token.type() == STRING_TYPE) {
     eat(STRING_TYPE, "expecting string_type");
   
+  }
+  else if (curr_token.type() == VEC) {
+    eat(VEC, "expecting vec");
+  
   }
   else if (curr_token.type() == ID) {
     eat(ID, "expecting id");
@@ -648,7 +895,7 @@ void Parser::dtype()
   else {
     error("unexpected token ");
   }
-
+  return type;
 }
 
 #endif
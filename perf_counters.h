@@ -0,0 +1,190 @@
+//----------------------------------------------------------------------
+// NAME: Charles Walker
+// FILE: perf_counters.h
+// DATE: Spring 2021
+// DESC: Hardware performance counters (Linux perf_event_open) for
+//       measuring the phases of a run: cycles, instructions (and so
+//       instructions per cycle), branch misses, and L1 data and
+//       last-level cache misses. Only user-space events of this
+//       process (and threads it starts later) are counted. Counters
+//       the kernel or hardware does not offer (e.g., in a VM, with a
+//       strict perf_event_paranoid, or on other systems) are reported
+//       as unavailable instead of failing.
+//----------------------------------------------------------------------
+
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <ostream>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+class PerfCounters
+{
+public:
+
+  enum Event {CYCLES, INSTRUCTIONS, BRANCH_MISSES, L1D_MISSES, LLC_MISSES, EVENTS};
+
+  // the counts of each event (over some interval)
+  struct Reading {
+    bool valid[EVENTS] = {};
+    double count[EVENTS] = {};
+    // instructions per cycle (0 if not both counted)
+    double ipc() const;
+    // the counts from start to this reading
+    Reading operator-(const Reading& start) const;
+  };
+
+  // open and start the counters
+  PerfCounters();
+  ~PerfCounters();
+
+  // true if any counter could be opened
+  bool available() const;
+
+  // the counts since the counters were opened
+  Reading read() const;
+
+  // write a header line and then one row per phase
+  static void header(std::ostream& out);
+  static void row(std::ostream& out, const std::string& phase, const Reading& reading);
+
+private:
+
+  int fds[EVENTS];
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+};
+
+
+double PerfCounters::Reading::ipc() const
+{
+  if (!valid[CYCLES] || !valid[INSTRUCTIONS] || count[CYCLES] == 0)
+    return 0;
+  return count[INSTRUCTIONS] / count[CYCLES];
+}
+
+
+PerfCounters::Reading PerfCounters::Reading::operator-(const Reading& start) const
+{
+  Reading diff;
+  for (int i = 0; i < EVENTS; ++i) {
+    diff.valid[i] = valid[i] && start.valid[i];
+    diff.count[i] = count[i] - start.count[i];
+  }
+  return diff;
+}
+
+
+PerfCounters::PerfCounters()
+{
+  for (int i = 0; i < EVENTS; ++i)
+    fds[i] = -1;
+#ifdef __linux__
+  const uint32_t cache = PERF_TYPE_HW_CACHE;
+  const uint64_t read_miss = (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  const uint32_t types[EVENTS] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                  PERF_TYPE_HARDWARE, cache, cache};
+  const uint64_t configs[EVENTS] = {PERF_COUNT_HW_CPU_CYCLES,
+                                    PERF_COUNT_HW_INSTRUCTIONS,
+                                    PERF_COUNT_HW_BRANCH_MISSES,
+                                    PERF_COUNT_HW_CACHE_L1D | read_miss,
+                                    PERF_COUNT_HW_CACHE_LL | read_miss};
+  for (int i = 0; i < EVENTS; ++i) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = types[i];
+    attr.config = configs[i];
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = 1;
+    // scale for the time a counter was not scheduled (if multiplexed)
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+#endif
+}
+
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+  for (int i = 0; i < EVENTS; ++i)
+    if (fds[i] >= 0)
+      close(fds[i]);
+#endif
+}
+
+
+bool PerfCounters::available() const
+{
+  for (int i = 0; i < EVENTS; ++i)
+    if (fds[i] >= 0)
+      return true;
+  return false;
+}
+
+
+PerfCounters::Reading PerfCounters::read() const
+{
+  Reading reading;
+#ifdef __linux__
+  for (int i = 0; i < EVENTS; ++i) {
+    uint64_t values[3];   // count, time enabled, time running
+    if (fds[i] < 0 || ::read(fds[i], values, sizeof(values)) != sizeof(values))
+      continue;
+    reading.valid[i] = true;
+    reading.count[i] = values[2] > 0 ? (double)values[0] * values[1] / values[2] : 0;
+  }
+#endif
+  return reading;
+}
+
+
+void PerfCounters::header(std::ostream& out)
+{
+  out << std::left << std::setw(12) << "phase" << std::right
+      << std::setw(16) << "cycles" << std::setw(16) << "instructions"
+      << std::setw(8) << "IPC" << std::setw(14) << "branch-miss"
+      << std::setw(14) << "L1d-miss" << std::setw(14) << "LLC-miss" << "\n";
+}
+
+
+void PerfCounters::row(std::ostream& out, const std::string& phase, const Reading& reading)
+{
+  const int widths[EVENTS] = {16, 16, 14, 14, 14};
+  out << std::left << std::setw(12) << phase << std::right;
+  for (int i = 0; i < EVENTS; ++i) {
+    if (i == BRANCH_MISSES) {
+      out << std::setw(8);
+      if (reading.ipc() > 0)
+        out << std::fixed << std::setprecision(2) << reading.ipc();
+      else
+        out << "-";
+      out.unsetf(std::ios::fixed);
+    }
+    out << std::setw(widths[i]);
+    if (reading.valid[i])
+      out << (unsigned long long)std::max(0.0, reading.count[i]);
+    else
+      out << "n/a";
+  }
+  out << "\n";
+}
+
+
+#endif
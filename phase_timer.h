@@ -0,0 +1,128 @@
+//----------------------------------------------------------------------
+// NAME: Charles Walker
+// FILE: phase_timer.h
+// DATE: Spring 2021
+// DESC: Measures the phases of a run (lex, parse, typecheck,
+//       interpret) for mypl --time-phases and --stats: the wall time,
+//       the change in the process's resident set size (RSS), and the
+//       hardware counters (if given), along with what the phase made
+//       (e.g., its token or AST node count). The RSS is read from
+//       /proc/self/statm, and is 0 where that does not exist. Memory
+//       freed by an earlier phase may be reused by a later one, so a
+//       delta can be smaller than what the phase allocated.
+//----------------------------------------------------------------------
+
+
+#ifndef PHASE_TIMER_H
+#define PHASE_TIMER_H
+
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+
+// the measurements of one phase
+struct Phase
+{
+  std::string name;
+  double ms = 0;                    // wall time
+  long long rss_delta = 0;          // bytes
+  PerfCounters::Reading counters;   // (if read)
+  std::string detail;               // e.g., "1234 tokens"
+};
+
+
+class PhaseTimer
+{
+public:
+
+  // start timing a phase (reading the counters too, if given)
+  PhaseTimer(const PerfCounters* counters = nullptr);
+
+  // the measurements of the phase so far
+  Phase read(const std::string& name, const std::string& detail = "") const;
+
+  // the resident set size of the process in bytes (0 if unknown)
+  static long long rss();
+
+  // write the time and memory of each phase
+  static void report(std::ostream& out, const std::vector<Phase>& phases);
+
+private:
+
+  const PerfCounters* counters;
+  std::chrono::steady_clock::time_point start_time;
+  long long start_rss;
+  PerfCounters::Reading start_counters;
+};
+
+
+PhaseTimer::PhaseTimer(const PerfCounters* counters)
+  : counters(counters), start_rss(rss())
+{
+  if (counters)
+    start_counters = counters->read();
+  start_time = std::chrono::steady_clock::now();
+}
+
+
+Phase PhaseTimer::read(const std::string& name, const std::string& detail) const
+{
+  Phase phase;
+  phase.ms = std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - start_time).count();
+  if (counters)
+    phase.counters = counters->read() - start_counters;
+  phase.rss_delta = rss() - start_rss;
+  phase.name = name;
+  phase.detail = detail;
+  return phase;
+}
+
+
+long long PhaseTimer::rss()
+{
+#ifdef __linux__
+  FILE* statm = fopen("/proc/self/statm", "r");
+  if (statm == nullptr)
+    return 0;
+  long long size = 0;
+  long long resident = 0;
+  int fields = fscanf(statm, "%lld %lld", &size, &resident);
+  fclose(statm);
+  if (fields == 2)
+    return resident * sysconf(_SC_PAGESIZE);
+#endif
+  return 0;
+}
+
+
+void PhaseTimer::report(std::ostream& out, const std::vector<Phase>& phases)
+{
+  out << std::left << std::setw(12) << "phase" << std::right
+      << std::setw(12) << "wall ms" << std::setw(16) << "RSS delta KB"
+      << "   " << "produced" << "\n";
+  double total = 0;
+  for (const Phase& phase : phases) {
+    total += phase.ms;
+    out << std::left << std::setw(12) << phase.name << std::right
+        << std::fixed << std::setprecision(3) << std::setw(12) << phase.ms
+        << std::showpos << std::setw(16) << phase.rss_delta / 1024
+        << std::noshowpos << "   " << phase.detail << "\n";
+    out.unsetf(std::ios::fixed);
+  }
+  out << std::left << std::setw(12) << "(total)" << std::right << std::fixed
+      << std::setprecision(3) << std::setw(12) << total << "\n";
+  out.unsetf(std::ios::fixed);
+}
+
+
+#endif
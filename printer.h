@@ -12,6 +12,7 @@
 #include <iostream>
 #include "ast.h"
 #include <string>
+#include <vector>
 
 
 
@@ -34,6 +35,7 @@ public:
   void visit(IfStmt& node);
   void visit(WhileStmt& node);
   void visit(ForStmt& node);
+  void visit(ParForStmt& node);
   // expressions
   void visit(Expr& node);
   void visit(SimpleTerm& node);
@@ -44,6 +46,8 @@ public:
   void visit(CallExpr& node);
   void visit(IDRValue& node);
   void visit(NegatedRValue& node);
+  void visit(ArrayRValue& node);
+  void visit(SpawnRValue& node);
 
 private:
   std::ostream& out;
@@ -139,7 +143,13 @@ private:
       ids_str += lval.lexeme();
       ids_str += " ";
     }
-    out << get_indent() + ids_str + "= ";
+    out << get_indent() + ids_str;
+    for (Expr* e : node.indices) {
+      out << "[ ";
+      e->accept(*this);
+      out << "] ";
+    }
+    out << "= ";
     node.expr->accept(*this);
     out << "\n";
   }
@@ -220,21 +230,48 @@ private:
     dec_indent();
     out << "end\n";
   }
+  void Printer::visit(ParForStmt& node)
+  {
+    out << get_indent() + "parfor " + node.var_id.lexeme() + " " + "= ";
+    node.start->accept(*this); 
+    out << "to ";
+    node.end->accept(*this);
+    out << "do\n";
+    inc_indent();
+    for(Stmt* s : node.stmts) 
+    {
+      s->accept(*this);
+    }
+    dec_indent();
+    out << "end\n";
+  }
   // expressions
   void Printer::visit(Expr& node)
   {
     // out << "exprdecl'\n'";
-    if (node.negated == true)
-      out << "not ";
-    //first term
-    node.first->accept(*this);
-    //if there is an operator
-    if(node.op != nullptr) {
-      out << node.op->lexeme() + " ";
+    // the expressions on the left (see left_spine) open their complex
+    // terms first, and are closed from the innermost one out
+    std::vector<Expr*> spine;
+    left_spine(node, spine);
+    for (Expr* e : spine) {
+      if (e->negated == true)
+        out << "not ";
+      if (e != spine.back())
+        out << "( ";
     }
-    //if there is an expression after operator
-    if(node.rest != nullptr) {
-      node.rest->accept(*this);
+    //first term
+    spine.back()->first->accept(*this);
+    for (auto e = spine.rbegin(); e != spine.rend(); ++e) {
+      if (*e != spine.back())
+        out << ") ";
+      //if there is an operator
+      if((*e)->op != nullptr) {
+        out << (*e)->op->lexeme() + " ";
+      }
+      //if there is an expression after operator
+      if((*e)->rest != nullptr) {
+        (*e)->rest->accept(*this);
+      }
     }
   }
 
@@ -259,7 +296,17 @@ private:
   void Printer::visit(NewRValue& node)
   {
     // out << "newrval'\n'";
-    out << node.type_id.lexeme(); 
+    out << "new " + node.type_id.lexeme() + " ";
+    if (node.array_size != nullptr) {
+      out << "[ ";
+      node.array_size->accept(*this);
+      out << "] ";
+    }
+    if (node.vec_length != nullptr) {
+      out << "( ";
+      node.vec_length->accept(*this);
+      out << ") ";
+    }
   }
   void Printer::visit(CallExpr& node)
   {
@@ -284,12 +331,29 @@ private:
     if (ids_str.size() > 1)
       ids_str.pop_back();
     out << ids_str + " ";
+    for (Expr* e : node.indices) {
+      out << "[ ";
+      e->accept(*this);
+      out << "] ";
+    }
   }
   void Printer::visit(NegatedRValue& node)
   {
     // out << "negated'\n'";
     // out << node.value.lexeme() + '\n'; 
   }
+  void Printer::visit(ArrayRValue& node)
+  {
+    out << "[ ";
+    for (Expr* e : node.elements)
+      e->accept(*this);
+    out << "] ";
+  }
+  void Printer::visit(SpawnRValue& node)
+  {
+    out << "spawn ";
+    node.call->accept(*this);
+  }
 
 
 #endif
@@ -0,0 +1,382 @@
+//----------------------------------------------------------------------
+// NAME: Charles Walker
+// FILE: profiler.h
+// DATE: Spring 2021
+// DESC: A sampling profiler for MyPL programs (mypl --profile). The
+//       interpreter keeps a shadow call stack on each thread: a frame
+//       per user-defined function call holding the statement being
+//       run. A SIGPROF timer samples the stack of the running thread
+//       into preallocated buffers (the handler only copies frames), and
+//       after the run the samples are summarized as self and total
+//       time per function and per line, and written as folded stacks
+//       (e.g., "main:12;fib:5;fib:5 37") for flame graph tools.
+//----------------------------------------------------------------------
+
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/time.h>
+#include "ast.h"
+
+
+// the MyPL calls active on a thread
+class ShadowStack
+{
+public:
+
+  // enter a call of the function (nullptr for a parfor chunk)
+  void push(const ASTNode* fun);
+
+  // leave the innermost call
+  void pop();
+
+  // the statement the innermost call is running
+  void at(const Stmt* stmt);
+
+private:
+
+  friend class Profiler;
+
+  // only the outermost frames are kept; deeper calls are counted in
+  // depth (and sampled as truncated)
+  static const int MAX_FRAMES = 128;
+
+  struct Frame {
+    const ASTNode* fun;
+    const Stmt* stmt;
+  };
+
+  // zero-initialized (see Profiler::stack)
+  Frame frames[MAX_FRAMES];
+  volatile int depth;
+};
+
+
+class Profiler
+{
+public:
+
+  // the shadow stack of the current thread
+  static thread_local ShadowStack stack;
+
+  // start sampling at the given rate (false if the timer could not be
+  // started)
+  static bool start(int hz = 1000);
+
+  // stop sampling
+  static void stop();
+
+  // write the self and total time of each function and line (the AST
+  // of the profiled program must still exist)
+  static void report(std::ostream& out);
+
+  // write the samples as folded stacks
+  static void write_folded(std::ostream& out);
+
+private:
+
+  typedef ShadowStack::Frame Frame;
+
+  struct Sample {
+    size_t first;       // index of the outermost frame in frames
+    int count;          // number of frames (-1 if dropped)
+    bool truncated;     // true if inner frames were dropped
+  };
+
+  // the sample buffers (filled by the signal handler)
+  static std::vector<Frame> frames;
+  static std::vector<Sample> samples;
+  static std::atomic<size_t> frames_used;
+  static std::atomic<size_t> samples_used;
+  static std::atomic<size_t> dropped;
+
+  // the requested rate, and the CPU time sampled (the timer may fire
+  // less often than requested, so each sample stands for an equal
+  // share of that time)
+  static int rate;
+  static std::clock_t start_clock;
+  static double cpu_ms;
+
+  // the SIGPROF handler
+  static void on_sample(int sig);
+
+  // the name and line of a frame
+  static std::string name(const Frame& frame);
+  static int line(const Frame& frame);
+
+  // the line of a frame, caching the lines of statements
+  static int cached_line(const Frame& frame, std::unordered_map<const Stmt*,int>& cache);
+
+  // the number of sample slots filled (some may be dropped)
+  static size_t slots_used();
+};
+
+
+thread_local ShadowStack Profiler::stack;
+std::vector<Profiler::Frame> Profiler::frames;
+std::vector<Profiler::Sample> Profiler::samples;
+std::atomic<size_t> Profiler::frames_used {0};
+std::atomic<size_t> Profiler::samples_used {0};
+std::atomic<size_t> Profiler::dropped {0};
+int Profiler::rate = 1000;
+std::clock_t Profiler::start_clock = 0;
+double Profiler::cpu_ms = 0;
+
+
+void ShadowStack::push(const ASTNode* fun)
+{
+  if (depth < MAX_FRAMES) {
+    Frame& frame = frames[depth];
+    frame.fun = fun;
+    frame.stmt = nullptr;
+    // the frame is complete before a sample can see it
+    std::atomic_signal_fence(std::memory_order_release);
+  }
+  depth = depth + 1;
+}
+
+
+void ShadowStack::pop()
+{
+  depth = depth - 1;
+}
+
+
+void ShadowStack::at(const Stmt* stmt)
+{
+  // nothing is kept outside of any call or past the kept frames
+  int d = depth;
+  if (d > 0 && d <= MAX_FRAMES)
+    frames[d - 1].stmt = stmt;
+}
+
+
+bool Profiler::start(int hz)
+{
+  rate = hz;
+  // about a minute of samples at average depth 16
+  frames.assign((size_t)hz * 60 * 16, Frame());
+  samples.assign((size_t)hz * 60, Sample());
+  frames_used = 0;
+  samples_used = 0;
+  dropped = 0;
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = on_sample;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  start_clock = std::clock();
+  if (sigaction(SIGPROF, &action, nullptr) != 0)
+    return false;
+  struct itimerval timer;
+  timer.it_interval.tv_sec = 0;
+  timer.it_interval.tv_usec = 1000000 / hz;
+  timer.it_value = timer.it_interval;
+  return setitimer(ITIMER_PROF, &timer, nullptr) == 0;
+}
+
+
+void Profiler::stop()
+{
+  struct itimerval timer;
+  memset(&timer, 0, sizeof(timer));
+  setitimer(ITIMER_PROF, &timer, nullptr);
+  signal(SIGPROF, SIG_IGN);
+  cpu_ms = 1000.0 * (std::clock() - start_clock) / CLOCKS_PER_SEC;
+}
+
+
+void Profiler::on_sample(int)
+{
+  const ShadowStack& s = stack;
+  int depth = s.depth;
+  std::atomic_signal_fence(std::memory_order_acquire);
+  int count = std::min(depth, (int)ShadowStack::MAX_FRAMES);
+  size_t i = samples_used.fetch_add(1);
+  size_t first = frames_used.fetch_add(count);
+  if (i >= samples.size() || first + count > frames.size()) {
+    ++dropped;
+    if (i < samples.size())
+      samples[i].count = -1;
+    return;
+  }
+  for (int j = 0; j < count; ++j)
+    frames[first + j] = s.frames[j];
+  samples[i].first = first;
+  samples[i].count = count;
+  samples[i].truncated = depth > count;
+}
+
+
+std::string Profiler::name(const Frame& frame)
+{
+  if (frame.fun == nullptr)
+    return "parfor";
+  return static_cast<const FunDecl*>(frame.fun) -> id.lexeme();
+}
+
+
+int Profiler::line(const Frame& frame)
+{
+  Stmt* s = const_cast<Stmt*>(frame.stmt);
+  if (VarDeclStmt* v = dynamic_cast<VarDeclStmt*>(s))
+    return v -> id.line();
+  if (AssignStmt* a = dynamic_cast<AssignStmt*>(s))
+    return a -> lvalue_list.front().line();
+  if (ReturnStmt* r = dynamic_cast<ReturnStmt*>(s))
+    return r -> expr -> first_token().line();
+  if (IfStmt* i = dynamic_cast<IfStmt*>(s))
+    return i -> if_part -> expr -> first_token().line();
+  if (WhileStmt* w = dynamic_cast<WhileStmt*>(s))
+    return w -> expr -> first_token().line();
+  if (ForStmt* f = dynamic_cast<ForStmt*>(s))
+    return f -> var_id.line();
+  if (CallExpr* c = dynamic_cast<CallExpr*>(s))
+    return c -> function_id.line();
+  // not yet at a statement
+  if (frame.fun != nullptr)
+    return static_cast<const FunDecl*>(frame.fun) -> id.line();
+  return 0;
+}
+
+
+int Profiler::cached_line(const Frame& frame, std::unordered_map<const Stmt*,int>& cache)
+{
+  // a frame not yet at a statement is at its function's line
+  if (frame.stmt == nullptr)
+    return line(frame);
+  auto cached = cache.find(frame.stmt);
+  if (cached == cache.end())
+    cached = cache.insert({frame.stmt, line(frame)}).first;
+  return cached -> second;
+}
+
+
+size_t Profiler::slots_used()
+{
+  return std::min((size_t)samples_used, samples.size());
+}
+
+
+void Profiler::report(std::ostream& out)
+{
+  // self and total samples per function and per function line
+  struct Counts {
+    size_t self = 0;
+    size_t total = 0;
+  };
+  std::map<std::string,Counts> funs;
+  std::map<std::pair<std::string,int>,Counts> lines;
+  std::unordered_map<const Stmt*,int> line_cache;
+  size_t n = 0;
+  size_t outside = 0;
+  for (size_t i = 0; i < slots_used(); ++i) {
+    const Sample& sample = samples[i];
+    if (sample.count < 0)
+      continue;
+    ++n;
+    if (sample.count == 0) {
+      ++outside;
+      continue;
+    }
+    std::set<std::string> seen_funs;
+    std::set<std::pair<std::string,int>> seen_lines;
+    for (int j = 0; j < sample.count; ++j) {
+      const Frame& frame = frames[sample.first + j];
+      std::string fun = name(frame);
+      std::pair<std::string,int> fun_line(fun, cached_line(frame, line_cache));
+      if (seen_funs.insert(fun).second)
+        ++funs[fun].total;
+      if (seen_lines.insert(fun_line).second)
+        ++lines[fun_line].total;
+      if (j == sample.count - 1 && !sample.truncated) {
+        ++funs[fun].self;
+        ++lines[fun_line].self;
+      }
+    }
+    // the calls past the kept frames are unknown
+    if (sample.truncated) {
+      ++funs["[truncated]"].self;
+      ++funs["[truncated]"].total;
+    }
+  }
+  double ms = n > 0 ? cpu_ms / n : 0;
+  out << "profile: " << n << " samples over " << (long long)cpu_ms << " ms of CPU time";
+  if (dropped > 0)
+    out << " (" << dropped << " dropped)";
+  if (outside > 0)
+    out << ", " << outside << " outside of MyPL functions";
+  out << "\n";
+  if (n == 0)
+    return;
+  // one table, sorted by self time
+  auto table = [&](const std::string& title, std::vector<std::pair<std::string,Counts>> rows) {
+    std::sort(rows.begin(), rows.end(), [](const std::pair<std::string,Counts>& a,
+                                           const std::pair<std::string,Counts>& b) {
+      return a.second.self != b.second.self ? a.second.self > b.second.self
+                                            : a.second.total > b.second.total;
+    });
+    out << "\n" << std::left << std::setw(24) << title << std::right
+        << std::setw(12) << "self ms" << std::setw(8) << "self%"
+        << std::setw(12) << "total ms" << std::setw(8) << "total%" << "\n";
+    out << std::fixed << std::setprecision(1);
+    for (auto& row : rows)
+      out << std::left << std::setw(24) << row.first << std::right
+          << std::setw(12) << row.second.self * ms
+          << std::setw(8) << 100.0 * row.second.self / n
+          << std::setw(12) << row.second.total * ms
+          << std::setw(8) << 100.0 * row.second.total / n << "\n";
+    out.unsetf(std::ios::fixed);
+  };
+  std::vector<std::pair<std::string,Counts>> rows;
+  for (auto& f : funs)
+    rows.push_back(f);
+  table("function", rows);
+  rows.clear();
+  for (auto& l : lines)
+    rows.push_back({l.first.first + ":" + std::to_string(l.first.second), l.second});
+  table("line", rows);
+}
+
+
+void Profiler::write_folded(std::ostream& out)
+{
+  std::map<std::string,size_t> stacks;
+  std::unordered_map<const Stmt*,int> line_cache;
+  for (size_t i = 0; i < slots_used(); ++i) {
+    const Sample& sample = samples[i];
+    if (sample.count < 0)
+      continue;
+    std::string folded;
+    if (sample.count == 0)
+      folded = "[interpreter]";
+    for (int j = 0; j < sample.count; ++j) {
+      const Frame& frame = frames[sample.first + j];
+      if (!folded.empty())
+        folded += ";";
+      folded += name(frame) + ":" + std::to_string(cached_line(frame, line_cache));
+    }
+    if (sample.truncated)
+      folded += ";[truncated]";
+    ++stacks[folded];
+  }
+  for (auto& s : stacks)
+    out << s.first << " " << s.second << "\n";
+}
+
+
+#endif
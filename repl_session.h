@@ -0,0 +1,108 @@
+//----------------------------------------------------------------------
+// NAME: Charles Walker
+// FILE: repl_session.h
+// DATE: Spring 2021
+// DESC: An interactive MyPL session (mypl with no input file). Each
+//       input is the statements (and fun and type declarations) up to
+//       and including a return, whose value is displayed; ending the
+//       return with a ':' runs the input without waiting for the next
+//       line. The type checker and interpreter live for the whole
+//       session, so variables, functions, and types declared by one
+//       input are visible to the later ones, and each input is only
+//       checked and run once. An input with an error is reported and
+//       dropped without ending the session.
+//----------------------------------------------------------------------
+
+
+#ifndef REPL_SESSION_H
+#define REPL_SESSION_H
+
+#include <iostream>
+#include <memory>
+#include <vector>
+#include "mypl_exception.h"
+#include "lexer.h"
+#include "parser.h"
+#include "ast.h"
+#include "type_checker.h"
+#include "interpreter.h"
+
+
+class ReplSession
+{
+public:
+
+  // a session reading inputs from in and printing to out
+  ReplSession(std::istream& in = std::cin, std::ostream& out = std::cout);
+
+  // read, check, and run the next input; returns false once the end
+  // of the input has been reached
+  bool step();
+
+  // run inputs until the end of the input; returns 1 if any input
+  // had an error (otherwise 0)
+  int run();
+
+private:
+
+  std::ostream& out;
+
+  Parser parser;
+  TypeChecker type_checker;
+  Interpreter interpreter;
+
+  // inputs with declarations (the interpreter refers to their
+  // function and type nodes for the rest of the session)
+  std::vector<std::unique_ptr<Repl>> decl_inputs;
+
+  // true if an input had an error
+  bool failed = false;
+};
+
+
+ReplSession::ReplSession(std::istream& in, std::ostream& out)
+  : out(out), parser(Lexer(in)), interpreter(out, in)
+{
+}
+
+
+bool ReplSession::step()
+{
+  out << "Enter statements: \n";
+  std::unique_ptr<Repl> input(new Repl());
+  try {
+    parser.parse(*input);
+  } catch (MyPLException& e) {
+    out << e.to_string() << std::endl;
+    failed = true;
+    parser.recover();
+    return !parser.eof_found;
+  }
+  bool checked = false;
+  try {
+    input->accept(type_checker);
+    checked = true;
+    input->accept(interpreter);
+  } catch (MyPLException& e) {
+    out << e.to_string() << std::endl;
+    failed = true;
+    // the checker already accepted the input's globals, but they were
+    // never (fully) set by the interpreter
+    if (checked)
+      type_checker.undo_repl_input();
+  }
+  if (checked && !input->decls.empty())
+    decl_inputs.push_back(std::move(input));
+  return !parser.eof_found;
+}
+
+
+int ReplSession::run()
+{
+  while (step())
+    ;
+  return failed ? 1 : 0;
+}
+
+
+#endif
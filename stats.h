@@ -0,0 +1,250 @@
+//----------------------------------------------------------------------
+// NAME: Charles Walker
+// FILE: stats.h
+// DATE: Spring 2021
+// DESC: Interpreter statistics (mypl --stats): AST node visits by
+//       kind, data value allocations and copies, symbol table
+//       environment pushes, pops, and lookups, heap and call frame
+//       objects created, and calls of each built-in function. Node,
+//       environment, object, and built-in counts come from the
+//       Instrumented interpreter (see instrumentation.h). DataObject
+//       and SymbolTable are not instrumented, so they count data
+//       values and lookups only while an Instrumented interpreter
+//       exists, which leaves the plain interpreter a single untaken
+//       branch. Each thread counts into its own (thread-local)
+//       counters, so counting is a plain increment, and the threads'
+//       counters are added up for the report.
+//----------------------------------------------------------------------
+
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+class Stats
+{
+public:
+
+  // the kinds of AST nodes the interpreter visits
+  enum Node {PROGRAM, FUN_DECL, REPL, TYPE_DECL, REPL_ENDPOINT,
+             VAR_DECL_STMT, ASSIGN_STMT, RETURN_STMT, IF_STMT,
+             WHILE_STMT, FOR_STMT, PARFOR_STMT, EXPR, SIMPLE_TERM,
+             COMPLEX_TERM, SIMPLE_RVALUE, NEW_RVALUE, CALL_EXPR,
+             ID_RVALUE, NEGATED_RVALUE, ARRAY_RVALUE, SPAWN_RVALUE,
+             NODE_KINDS};
+
+  // the built-in functions
+  enum Builtin {PRINT, STOI, STOD, ITOS, DTOS, PUT, HAS, REMOVE, PUSH,
+                POP, PEEK, GET, LENGTH, FIND, COUNT, SPLIT_COUNT,
+                STARTS_WITH, COMPARE, UPPER, LOWER, DOT, ADD, MUL, SUM,
+                NORM, JOIN, SIZE, READ, BUILTINS};
+
+  struct Counters {
+    size_t visits[NODE_KINDS];
+    size_t builtins[BUILTINS];
+    size_t data_allocs;         // data values allocated (by set)
+    size_t data_copies;         // data values copied
+    size_t env_pushes;
+    size_t env_pops;
+    size_t lookups;             // names looked up in the environments
+    size_t lookup_depth;        // environments searched by the lookups
+    size_t heap_objects;        // objects given an oid (never freed)
+    size_t frame_objects;       // objects kept on a call's frame
+  };
+
+  // the current thread's counters (zero-initialized)
+  static thread_local Counters local;
+
+  // count a visit of the given kind of node
+  static void visit(Node kind);
+
+  // count a call of the given built-in
+  static void call(Builtin fun);
+
+  // count a data value allocated or copied, and a name looked up by
+  // searching depth environments (only while data_counters > 0)
+  static void data_alloc();
+  static void data_copy();
+  static void lookup(size_t depth);
+
+  // the Instrumented interpreters that exist, which count data values
+  // and lookups as well (see Instrumented::start and stop)
+  static std::atomic<int> data_counters;
+
+  // include the current thread's counters in the report until the
+  // thread calls detach (for threads that end before the report)
+  static void attach();
+  static void detach();
+
+  // zero the counters of every thread
+  static void reset();
+
+  // write the counters added up over all threads
+  static void report(std::ostream& out);
+
+private:
+
+  // the counters of attached threads, and the sum of detached ones
+  static std::mutex lock;
+  static std::vector<Counters*> attached;
+  static Counters detached;
+
+  // add the counters to the total
+  static void add(Counters& total, const Counters& counts);
+};
+
+
+thread_local Stats::Counters Stats::local;
+std::mutex Stats::lock;
+std::vector<Stats::Counters*> Stats::attached;
+Stats::Counters Stats::detached;
+std::atomic<int> Stats::data_counters(0);
+
+
+void Stats::visit(Node kind)
+{
+  ++local.visits[kind];
+}
+
+
+void Stats::call(Builtin fun)
+{
+  ++local.builtins[fun];
+}
+
+
+void Stats::data_alloc()
+{
+  if (data_counters.load(std::memory_order_relaxed) > 0)
+    ++local.data_allocs;
+}
+
+
+void Stats::data_copy()
+{
+  if (data_counters.load(std::memory_order_relaxed) > 0)
+    ++local.data_copies;
+}
+
+
+void Stats::lookup(size_t depth)
+{
+  if (data_counters.load(std::memory_order_relaxed) > 0) {
+    ++local.lookups;
+    local.lookup_depth += depth;
+  }
+}
+
+
+void Stats::attach()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  attached.push_back(&local);
+}
+
+
+void Stats::detach()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  attached.erase(std::remove(attached.begin(), attached.end(), &local), attached.end());
+  add(detached, local);
+  local = Counters();
+}
+
+
+void Stats::reset()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  for (Counters* counts : attached)
+    *counts = Counters();
+  detached = Counters();
+  local = Counters();
+}
+
+
+void Stats::add(Counters& total, const Counters& counts)
+{
+  for (int i = 0; i < NODE_KINDS; ++i)
+    total.visits[i] += counts.visits[i];
+  for (int i = 0; i < BUILTINS; ++i)
+    total.builtins[i] += counts.builtins[i];
+  total.data_allocs += counts.data_allocs;
+  total.data_copies += counts.data_copies;
+  total.env_pushes += counts.env_pushes;
+  total.env_pops += counts.env_pops;
+  total.lookups += counts.lookups;
+  total.lookup_depth += counts.lookup_depth;
+  total.heap_objects += counts.heap_objects;
+  total.frame_objects += counts.frame_objects;
+}
+
+
+void Stats::report(std::ostream& out)
+{
+  static const char* NODE_NAMES[NODE_KINDS] = {
+    "Program", "FunDecl", "Repl", "TypeDecl", "ReplEndpoint",
+    "VarDeclStmt", "AssignStmt", "ReturnStmt", "IfStmt", "WhileStmt",
+    "ForStmt", "ParForStmt", "Expr", "SimpleTerm", "ComplexTerm",
+    "SimpleRValue", "NewRValue", "CallExpr", "IDRValue",
+    "NegatedRValue", "ArrayRValue", "SpawnRValue"};
+  static const char* BUILTIN_NAMES[BUILTINS] = {
+    "print", "stoi", "stod", "itos", "dtos", "put", "has", "remove",
+    "push", "pop", "peek", "get", "length", "find", "count",
+    "split_count", "starts_with", "compare", "upper", "lower", "dot",
+    "add", "mul", "sum", "norm", "join", "size", "read"};
+  Counters total = Counters();
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    add(total, detached);
+    for (Counters* counts : attached)
+      if (counts != &local)
+        add(total, *counts);
+  }
+  add(total, local);
+  auto row = [&](const std::string& name, size_t count) {
+    out << "  " << std::left << std::setw(22) << name << std::right
+        << std::setw(14) << count << "\n";
+  };
+  out << "node visits:\n";
+  size_t visits = 0;
+  for (int i = 0; i < NODE_KINDS; ++i) {
+    visits += total.visits[i];
+    if (total.visits[i] > 0)
+      row(NODE_NAMES[i], total.visits[i]);
+  }
+  row("(total)", visits);
+  out << "data values:\n";
+  row("allocated", total.data_allocs);
+  row("copied", total.data_copies);
+  out << "symbol table:\n";
+  row("environments pushed", total.env_pushes);
+  row("environments popped", total.env_pops);
+  row("lookups", total.lookups);
+  out << "  " << std::left << std::setw(22) << "average lookup depth" << std::right
+      << std::setw(14) << std::fixed << std::setprecision(2)
+      << (total.lookups > 0 ? (double)total.lookup_depth / total.lookups : 0.0) << "\n";
+  out.unsetf(std::ios::fixed);
+  out << "objects:\n";
+  row("heap (all live)", total.heap_objects);
+  row("call frame", total.frame_objects);
+  out << "built-in calls:\n";
+  size_t calls = 0;
+  for (int i = 0; i < BUILTINS; ++i) {
+    calls += total.builtins[i];
+    if (total.builtins[i] > 0)
+      row(BUILTIN_NAMES[i], total.builtins[i]);
+  }
+  row("(total)", calls);
+}
+
+
+#endif
@@ -0,0 +1,416 @@
+//----------------------------------------------------------------------
+// NAME: Charles Walker
+// FILE: string_kernels.h
+// DATE: Spring 2021
+// DESC: Vectorized string kernels behind the MyPL string built-ins
+//       (find, count, starts_with, compare, upper, lower, and
+//       split_count). Each kernel has a scalar, SSE2, and AVX2
+//       version; the widest one the CPU supports is chosen at run
+//       time (see cpu_features.h). All kernels work directly on the
+//       (chars, length) view of a string and never copy it.
+//----------------------------------------------------------------------
+
+
+#ifndef STRING_KERNELS_H
+#define STRING_KERNELS_H
+
+#include <cstring>
+#include <cstddef>
+#include "cpu_features.h"
+
+#ifdef MYPL_X86
+#include <immintrin.h>
+#endif
+
+
+class StringKernels
+{
+public:
+
+  // returned by find and find_char when there is no match
+  static const size_t npos = (size_t)-1;
+
+  // index of the first c in s[0..n), or npos
+  static size_t find_char(const char* s, size_t n, char c);
+
+  // index of the first occurrence of t[0..m) in s[0..n), or npos
+  static size_t find(const char* s, size_t n, const char* t, size_t m);
+
+  // number of c's in s[0..n)
+  static size_t count_char(const char* s, size_t n, char c);
+
+  // index of the first position where a and b differ, or n
+  static size_t mismatch(const char* a, const char* b, size_t n);
+
+  // lexicographic comparison (-1, 0, or 1) of a[0..n) and b[0..m)
+  static int compare(const char* a, size_t n, const char* b, size_t m);
+
+  // true if s[0..n) starts with p[0..m)
+  static bool starts_with(const char* s, size_t n, const char* p, size_t m);
+
+  // writes s[0..n) to out[0..n) with ASCII letters changed to upper
+  // (or lower) case; out may equal s
+  static void to_upper(const char* s, size_t n, char* out);
+  static void to_lower(const char* s, size_t n, char* out);
+
+private:
+
+  // scalar versions (also used for the tails of the vector loops)
+  static size_t scalar_find_char(const char* s, size_t n, char c);
+  static size_t scalar_find(const char* s, size_t n, const char* t, size_t m);
+  static size_t scalar_count_char(const char* s, size_t n, char c);
+  static size_t scalar_mismatch(const char* a, const char* b, size_t n);
+  static void scalar_change_case(const char* s, size_t n, char* out, char lo);
+
+#ifdef MYPL_X86
+  static size_t sse2_find_char(const char* s, size_t n, char c);
+  static size_t sse2_find(const char* s, size_t n, const char* t, size_t m);
+  static size_t sse2_count_char(const char* s, size_t n, char c);
+  static size_t sse2_mismatch(const char* a, const char* b, size_t n);
+  static void sse2_change_case(const char* s, size_t n, char* out, char lo);
+
+  __attribute__((target("avx2")))
+  static size_t avx2_find_char(const char* s, size_t n, char c);
+  __attribute__((target("avx2")))
+  static size_t avx2_find(const char* s, size_t n, const char* t, size_t m);
+  __attribute__((target("avx2")))
+  static size_t avx2_count_char(const char* s, size_t n, char c);
+  __attribute__((target("avx2")))
+  static size_t avx2_mismatch(const char* a, const char* b, size_t n);
+  __attribute__((target("avx2")))
+  static void avx2_change_case(const char* s, size_t n, char* out, char lo);
+#endif
+};
+
+
+const size_t StringKernels::npos;
+
+
+//----------------------------------------------------------------------
+// Dispatch
+//----------------------------------------------------------------------
+
+size_t StringKernels::find_char(const char* s, size_t n, char c)
+{
+#ifdef MYPL_X86
+  if (CPUFeatures::avx2())
+    return avx2_find_char(s, n, c);
+  if (CPUFeatures::sse2())
+    return sse2_find_char(s, n, c);
+#endif
+  return scalar_find_char(s, n, c);
+}
+
+
+size_t StringKernels::find(const char* s, size_t n, const char* t, size_t m)
+{
+  if (m == 0)
+    return 0;
+  if (m > n)
+    return npos;
+  if (m == 1)
+    return find_char(s, n, t[0]);
+#ifdef MYPL_X86
+  if (CPUFeatures::avx2())
+    return avx2_find(s, n, t, m);
+  if (CPUFeatures::sse2())
+    return sse2_find(s, n, t, m);
+#endif
+  return scalar_find(s, n, t, m);
+}
+
+
+size_t StringKernels::count_char(const char* s, size_t n, char c)
+{
+#ifdef MYPL_X86
+  if (CPUFeatures::avx2())
+    return avx2_count_char(s, n, c);
+  if (CPUFeatures::sse2())
+    return sse2_count_char(s, n, c);
+#endif
+  return scalar_count_char(s, n, c);
+}
+
+
+size_t StringKernels::mismatch(const char* a, const char* b, size_t n)
+{
+#ifdef MYPL_X86
+  if (CPUFeatures::avx2())
+    return avx2_mismatch(a, b, n);
+  if (CPUFeatures::sse2())
+    return sse2_mismatch(a, b, n);
+#endif
+  return scalar_mismatch(a, b, n);
+}
+
+
+int StringKernels::compare(const char* a, size_t n, const char* b, size_t m)
+{
+  size_t k = n < m ? n : m;
+  size_t i = a == b ? k : mismatch(a, b, k);
+  if (i < k)
+    return (unsigned char)a[i] < (unsigned char)b[i] ? -1 : 1;
+  return n < m ? -1 : (n > m ? 1 : 0);
+}
+
+
+bool StringKernels::starts_with(const char* s, size_t n, const char* p, size_t m)
+{
+  return m <= n and mismatch(s, p, m) == m;
+}
+
+
+void StringKernels::to_upper(const char* s, size_t n, char* out)
+{
+#ifdef MYPL_X86
+  if (CPUFeatures::avx2())
+    return avx2_change_case(s, n, out, 'a');
+  if (CPUFeatures::sse2())
+    return sse2_change_case(s, n, out, 'a');
+#endif
+  scalar_change_case(s, n, out, 'a');
+}
+
+
+void StringKernels::to_lower(const char* s, size_t n, char* out)
+{
+#ifdef MYPL_X86
+  if (CPUFeatures::avx2())
+    return avx2_change_case(s, n, out, 'A');
+  if (CPUFeatures::sse2())
+    return sse2_change_case(s, n, out, 'A');
+#endif
+  scalar_change_case(s, n, out, 'A');
+}
+
+
+//----------------------------------------------------------------------
+// Scalar kernels
+//----------------------------------------------------------------------
+
+size_t StringKernels::scalar_find_char(const char* s, size_t n, char c)
+{
+  for (size_t i = 0; i < n; ++i)
+    if (s[i] == c)
+      return i;
+  return npos;
+}
+
+
+size_t StringKernels::scalar_find(const char* s, size_t n, const char* t, size_t m)
+{
+  for (size_t i = 0; i + m <= n; ++i)
+    if (s[i] == t[0] and std::memcmp(s + i + 1, t + 1, m - 1) == 0)
+      return i;
+  return npos;
+}
+
+
+size_t StringKernels::scalar_count_char(const char* s, size_t n, char c)
+{
+  size_t count = 0;
+  for (size_t i = 0; i < n; ++i)
+    count += s[i] == c;
+  return count;
+}
+
+
+size_t StringKernels::scalar_mismatch(const char* a, const char* b, size_t n)
+{
+  for (size_t i = 0; i < n; ++i)
+    if (a[i] != b[i])
+      return i;
+  return n;
+}
+
+
+// flips the case of the letters in [lo, lo + 25] ('a' for upper
+// casing, 'A' for lower casing)
+void StringKernels::scalar_change_case(const char* s, size_t n, char* out, char lo)
+{
+  for (size_t i = 0; i < n; ++i) {
+    unsigned char d = (unsigned char)(s[i] - lo);
+    out[i] = d < 26 ? s[i] ^ 0x20 : s[i];
+  }
+}
+
+
+#ifdef MYPL_X86
+
+//----------------------------------------------------------------------
+// SSE2 kernels (16 bytes at a time)
+//----------------------------------------------------------------------
+
+size_t StringKernels::sse2_find_char(const char* s, size_t n, char c)
+{
+  const __m128i needle = _mm_set1_epi8(c);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i*)(s + i));
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+    if (mask)
+      return i + __builtin_ctz(mask);
+  }
+  size_t rest = scalar_find_char(s + i, n - i, c);
+  return rest == npos ? npos : i + rest;
+}
+
+
+// compares the first and last characters of t at every candidate
+// position at once, then checks the middle of each hit
+size_t StringKernels::sse2_find(const char* s, size_t n, const char* t, size_t m)
+{
+  const __m128i first = _mm_set1_epi8(t[0]);
+  const __m128i last = _mm_set1_epi8(t[m - 1]);
+  size_t i = 0;
+  for (; i + m - 1 + 16 <= n; i += 16) {
+    __m128i b0 = _mm_loadu_si128((const __m128i*)(s + i));
+    __m128i b1 = _mm_loadu_si128((const __m128i*)(s + i + m - 1));
+    unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(b0, first),
+                                                    _mm_cmpeq_epi8(b1, last)));
+    while (mask) {
+      size_t j = i + __builtin_ctz(mask);
+      if (std::memcmp(s + j + 1, t + 1, m - 2) == 0)
+        return j;
+      mask &= mask - 1;
+    }
+  }
+  size_t rest = scalar_find(s + i, n - i, t, m);
+  return rest == npos ? npos : i + rest;
+}
+
+
+size_t StringKernels::sse2_count_char(const char* s, size_t n, char c)
+{
+  const __m128i needle = _mm_set1_epi8(c);
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i*)(s + i));
+    count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+  }
+  return count + scalar_count_char(s + i, n - i, c);
+}
+
+
+size_t StringKernels::sse2_mismatch(const char* a, const char* b, size_t n)
+{
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+    __m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+    unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, y));
+    if (mask != 0xFFFF)
+      return i + __builtin_ctz(~mask);
+  }
+  return i + scalar_mismatch(a + i, b + i, n - i);
+}
+
+
+void StringKernels::sse2_change_case(const char* s, size_t n, char* out, char lo)
+{
+  const __m128i base = _mm_set1_epi8(lo);
+  const __m128i range = _mm_set1_epi8(25);
+  const __m128i flip = _mm_set1_epi8(0x20);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i*)(s + i));
+    // d <= 25 (unsigned) exactly when min(d, 25) == d
+    __m128i d = _mm_sub_epi8(block, base);
+    __m128i letter = _mm_cmpeq_epi8(_mm_min_epu8(d, range), d);
+    block = _mm_xor_si128(block, _mm_and_si128(letter, flip));
+    _mm_storeu_si128((__m128i*)(out + i), block);
+  }
+  scalar_change_case(s + i, n - i, out + i, lo);
+}
+
+
+//----------------------------------------------------------------------
+// AVX2 kernels (32 bytes at a time)
+//----------------------------------------------------------------------
+
+size_t StringKernels::avx2_find_char(const char* s, size_t n, char c)
+{
+  const __m256i needle = _mm256_set1_epi8(c);
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i*)(s + i));
+    unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle));
+    if (mask)
+      return i + __builtin_ctz(mask);
+  }
+  size_t rest = scalar_find_char(s + i, n - i, c);
+  return rest == npos ? npos : i + rest;
+}
+
+
+size_t StringKernels::avx2_find(const char* s, size_t n, const char* t, size_t m)
+{
+  const __m256i first = _mm256_set1_epi8(t[0]);
+  const __m256i last = _mm256_set1_epi8(t[m - 1]);
+  size_t i = 0;
+  for (; i + m - 1 + 32 <= n; i += 32) {
+    __m256i b0 = _mm256_loadu_si256((const __m256i*)(s + i));
+    __m256i b1 = _mm256_loadu_si256((const __m256i*)(s + i + m - 1));
+    unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(b0, first),
+                                                          _mm256_cmpeq_epi8(b1, last)));
+    while (mask) {
+      size_t j = i + __builtin_ctz(mask);
+      if (std::memcmp(s + j + 1, t + 1, m - 2) == 0)
+        return j;
+      mask &= mask - 1;
+    }
+  }
+  size_t rest = scalar_find(s + i, n - i, t, m);
+  return rest == npos ? npos : i + rest;
+}
+
+
+size_t StringKernels::avx2_count_char(const char* s, size_t n, char c)
+{
+  const __m256i needle = _mm256_set1_epi8(c);
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i*)(s + i));
+    unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle));
+    count += __builtin_popcount(mask);
+  }
+  return count + scalar_count_char(s + i, n - i, c);
+}
+
+
+size_t StringKernels::avx2_mismatch(const char* a, const char* b, size_t n)
+{
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+    __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+    unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+    if (mask != 0xFFFFFFFFu)
+      return i + __builtin_ctz(~mask);
+  }
+  return i + scalar_mismatch(a + i, b + i, n - i);
+}
+
+
+void StringKernels::avx2_change_case(const char* s, size_t n, char* out, char lo)
+{
+  const __m256i base = _mm256_set1_epi8(lo);
+  const __m256i range = _mm256_set1_epi8(25);
+  const __m256i flip = _mm256_set1_epi8(0x20);
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i*)(s + i));
+    __m256i d = _mm256_sub_epi8(block, base);
+    __m256i letter = _mm256_cmpeq_epi8(_mm256_min_epu8(d, range), d);
+    block = _mm256_xor_si256(block, _mm256_and_si256(letter, flip));
+    _mm256_storeu_si256((__m256i*)(out + i), block);
+  }
+  scalar_change_case(s + i, n - i, out + i, lo);
+}
+
+#endif
+
+
+#endif
@@ -9,10 +9,12 @@
 #ifndef SYMBOL_TABLE_H
 #define SYMBOL_TABLE_H
 
+#include <algorithm>
 #include <map>
 #include <vector>
 #include <list>
 #include "data_object.h"
+#include "stats.h"
 
 // string->string map to store type information for user-defined types
 typedef std::map<std::string,std::string> StringMap;
@@ -42,6 +44,9 @@ public:
   // add given name to the current environment
   void add_name(const std::string& name);
 
+  // remove given name (and its info) from the current environment
+  void remove_name(const std::string& name);
+
   // check if name exists in current or ancestor environments
   bool name_exists(const std::string& name) const;
 
@@ -51,6 +56,14 @@ public:
   // check if name exists in given environment
   bool name_exists_in_env(const std::string& name, int env_id) const;
 
+  // check if name exists in the given environment or in one of the
+  // environments nested within it (up to the current environment)
+  bool name_exists_since_env(const std::string& name, int env_id) const;
+
+  // add the names (with data-object info) visible from the current
+  // environment to the current environment of the given table
+  void copy_vals(SymbolTable& table) const;
+
   // set the name's symbol-table info (as a string)
   void set_str_info(const std::string& name, const std::string& info);
 
@@ -89,6 +102,10 @@ public:
   
   // give a string representation for printing/testing
   std::string to_string() const;
+
+  // the most names and environments the table has held at once
+  size_t peak_names() const;
+  size_t peak_environments() const;
   
 private:
 
@@ -134,6 +151,11 @@ private:
   // holds the current environment identifier
   int current_environment_id = 0;
 
+  // names in all environments, and the most held at once
+  size_t name_count = 0;
+  size_t max_names = 0;
+  size_t max_environments = 0;
+
   // gets the current environment index 
   int curr_env_index() const;
 
@@ -153,8 +175,8 @@ private:
 
 SymbolTable::~SymbolTable()
 {
-  for (std::pair<int,Environment> p1 : environments) {
-    for (std::pair<std::string,SymTableObject*> p2 : p1.second)
+  for (std::pair<int,Environment>& p1 : environments) {
+    for (const std::pair<const std::string,SymTableObject*>& p2 : p1.second)
       delete_sym_obj(p2.second);
     p1.second.clear();
   }
@@ -173,6 +195,7 @@ void SymbolTable::push_environment()
   else
     environments.insert(it + curr_env_index() + 1, env_entry);
   current_environment_id = env_entry.first;
+  max_environments = std::max(max_environments, environments.size());
 }
 
 
@@ -184,6 +207,7 @@ void SymbolTable::pop_environment()
   // clean up environment
   for (std::pair<std::string,SymTableObject*> m : environments[index].second)
     delete_sym_obj(m.second);
+  name_count -= environments[index].second.size();
   // remove the environment
   environments.erase(environments.begin() + index);
   if (index > 0)
@@ -209,7 +233,25 @@ void SymbolTable::add_name(const std::string& name)
 {
   if (environments.size() == 0)
     return;
-  environments[curr_env_index()].second[name] = nullptr;
+  Environment& env = environments[curr_env_index()].second;
+  size_t size = env.size();
+  env[name] = nullptr;
+  name_count += env.size() - size;
+  max_names = std::max(max_names, name_count);
+}
+
+
+void SymbolTable::remove_name(const std::string& name)
+{
+  if (environments.size() == 0)
+    return;
+  Environment& env = environments[curr_env_index()].second;
+  auto it = env.find(name);
+  if (it == env.end())
+    return;
+  delete_sym_obj(it->second);
+  env.erase(it);
+  --name_count;
 }
 
 
@@ -242,6 +284,12 @@ void SymbolTable::set_val_info(const std::string& name, const DataObject& info)
 {
   int index = -1;
   if (get_env_for_name(name, index)) {
+    // update an existing value in place
+    SymTableObject* curr = environments[index].second[name];
+    if (curr and curr->type() == VAL) {
+      ((ValObject*)curr)->obj_val = info;
+      return;
+    }
     ValObject* obj = new ValObject;
     obj->obj_val = info;
     if (environments[index].second[name])
@@ -422,6 +470,18 @@ std::string SymbolTable::to_string() const
 
 
 
+size_t SymbolTable::peak_names() const
+{
+  return max_names;
+}
+
+
+size_t SymbolTable::peak_environments() const
+{
+  return max_environments;
+}
+
+
 //----------------------------------------------------------------------
 // HELPER FUNCTIONS
 //----------------------------------------------------------------------
@@ -449,7 +509,7 @@ bool SymbolTable::name_exists_in_curr_env(const std::string& name) const
 
 bool SymbolTable::name_exists_in_env(const std::string& name, int env_id) const
 {
-  for (std::pair<int,Environment> env_entry : environments) {
+  for (const std::pair<int,Environment>& env_entry : environments) {
     if (env_entry.first == env_id)
       return env_entry.second.count(name) > 0;
   }
@@ -457,15 +517,45 @@ bool SymbolTable::name_exists_in_env(const std::string& name, int env_id) const
 }
 
 
+bool SymbolTable::name_exists_since_env(const std::string& name, int env_id) const
+{
+  int index = -1;
+  if (!get_env_for_name(name, index))
+    return false;
+  for (int i = 0; i < index; ++i) {
+    if (environments[i].first == env_id)
+      return true;
+  }
+  return environments[index].first == env_id;
+}
+
+
+void SymbolTable::copy_vals(SymbolTable& table) const
+{
+  // outer environments first, so inner names shadow them
+  int curr_index = curr_env_index();
+  for (int i = 0; i <= curr_index; ++i) {
+    for (const std::pair<const std::string,SymTableObject*>& p : environments[i].second) {
+      if (p.second and p.second->type() == VAL) {
+        table.add_name(p.first);
+        table.set_val_info(p.first, ((ValObject*)p.second)->obj_val);
+      }
+    }
+  }
+}
+
+
 bool SymbolTable::get_env_for_name(const std::string& name, int& index) const
 {
   int curr_index = curr_env_index();
   for (size_t i = curr_index + 1; i > 0; --i) {
     if (environments[i-1].second.count(name) > 0) {
+      Stats::lookup(curr_index + 2 - i);
       index = i - 1;
       return true;
     }
   }
+  Stats::lookup(curr_index + 1);
   return false;
 }
 
@@ -0,0 +1,312 @@
+//----------------------------------------------------------------------
+// NAME: Charles Walker
+// FILE: thread_pool.h
+// DATE: Spring 2021
+// DESC: A work-stealing thread pool for running parfor loops and
+//       spawned tasks. Each worker has a deque of jobs: it queues and
+//       takes its own jobs at the back (so recursive tasks run depth
+//       first) and, once its deque is empty, steals the oldest job
+//       from the front of another worker's deque. The threads are
+//       started once and reused; threads outside of the pool (e.g.,
+//       the main thread) use the first worker's deque. A thread that
+//       waits on a result runs queued jobs in the meantime, so
+//       waiting inside a job cannot deadlock the pool; with nothing
+//       left to run it spins briefly and then sleeps until a job
+//       finishes or is queued.
+//----------------------------------------------------------------------
+
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "stats.h"
+
+
+class ThreadPool
+{
+public:
+
+  typedef std::function<void()> Job;
+
+  // start a pool with the given number of workers (at least 1); the
+  // first worker is the thread that uses the pool
+  ThreadPool(size_t workers);
+
+  // stop and join the worker threads (jobs not yet started are dropped)
+  ~ThreadPool();
+
+  // stop and join the worker threads now, as the destructor does (for
+  // an owner whose jobs use the owner, so they must end before it is
+  // destroyed)
+  void stop();
+
+  // the number of workers (including the thread using the pool)
+  size_t size() const;
+
+  // queue a job on the calling worker's deque
+  void submit(const Job& job);
+
+  // run queued jobs until done() returns true
+  void help_until(const std::function<bool()>& done);
+
+  // run task(first, last) over the range first..last in chunks of the
+  // given size and wait for every chunk to finish. If a task throws,
+  // the remaining chunks are skipped and the first exception is
+  // rethrown here.
+  void run(int first, int last, int chunk, const std::function<void(int,int)>& task);
+
+  // the calling thread's worker index (0 for threads outside the pool)
+  size_t worker_id() const;
+
+  // the number of workers to use: the MYPL_THREADS environment
+  // variable if set, otherwise the number of hardware threads
+  static size_t default_size();
+
+private:
+
+  // a worker's jobs
+  struct Queue {
+    std::mutex lock;
+    std::deque<Job> jobs;
+  };
+
+  std::vector<std::thread> threads;
+  std::vector<std::unique_ptr<Queue>> queues;
+
+  // the number of queued jobs (idle workers sleep while it is 0)
+  std::atomic<size_t> pending {0};
+  // the number of threads sleeping in help_until (woken after each
+  // job, which may have given them their result)
+  std::atomic<size_t> waiting {0};
+  std::atomic<bool> stopping {false};
+  std::mutex sleep_lock;
+  std::condition_variable wake;
+
+  // the pool the current thread works for (if any) and its index
+  static thread_local const ThreadPool* worker_pool;
+  static thread_local size_t worker_index;
+
+  // the main loop of a pool thread
+  void work(size_t worker);
+
+  // take the next job (own deque first, then steal)
+  bool take(size_t worker, Job& job);
+
+  // run a job, then wake any threads waiting on a result
+  void run_job(Job& job);
+
+  // the times help_until yields before it sleeps
+  static const int SPINS = 64;
+};
+
+
+thread_local const ThreadPool* ThreadPool::worker_pool = nullptr;
+thread_local size_t ThreadPool::worker_index = 0;
+const int ThreadPool::SPINS;
+
+
+ThreadPool::ThreadPool(size_t workers)
+{
+  if (workers == 0)
+    workers = 1;
+  for (size_t i = 0; i < workers; ++i)
+    queues.emplace_back(new Queue);
+  for (size_t i = 1; i < workers; ++i)
+    threads.emplace_back(&ThreadPool::work, this, i);
+}
+
+
+ThreadPool::~ThreadPool()
+{
+  stop();
+}
+
+
+void ThreadPool::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(sleep_lock);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (std::thread& t : threads)
+    if (t.joinable())
+      t.join();
+}
+
+
+size_t ThreadPool::size() const
+{
+  return queues.size();
+}
+
+
+size_t ThreadPool::worker_id() const
+{
+  // pool threads may use other pools (e.g., a script in a batch run)
+  return worker_pool == this ? worker_index : 0;
+}
+
+
+size_t ThreadPool::default_size()
+{
+  const char* env = std::getenv("MYPL_THREADS");
+  if (env != nullptr && std::atoi(env) > 0)
+    return std::atoi(env);
+  size_t n = std::thread::hardware_concurrency();
+  return n > 0 ? n : 1;
+}
+
+
+void ThreadPool::submit(const Job& job)
+{
+  Queue& own = *queues[worker_id()];
+  {
+    std::lock_guard<std::mutex> lock(own.lock);
+    own.jobs.push_back(job);
+  }
+  ++pending;
+  // taking the lock orders the wake up after a sleeper's check
+  {
+    std::lock_guard<std::mutex> lock(sleep_lock);
+  }
+  wake.notify_one();
+}
+
+
+void ThreadPool::help_until(const std::function<bool()>& done)
+{
+  size_t worker = worker_id();
+  Job job;
+  int spins = 0;
+  while (!done()) {
+    if (take(worker, job)) {
+      run_job(job);
+      spins = 0;
+    }
+    else if (++spins < SPINS)
+      std::this_thread::yield();
+    else {
+      // the waiting count is raised before done() is checked, so a
+      // job finishing after the check sees it and wakes us
+      ++waiting;
+      {
+        std::unique_lock<std::mutex> lock(sleep_lock);
+        wake.wait(lock, [&] {return done() || pending > 0;});
+      }
+      --waiting;
+      spins = 0;
+    }
+  }
+}
+
+
+void ThreadPool::run_job(Job& job)
+{
+  job();
+  if (waiting > 0) {
+    // taking the lock orders the wake up after a waiter's check
+    {
+      std::lock_guard<std::mutex> lock(sleep_lock);
+    }
+    wake.notify_all();
+  }
+}
+
+
+void ThreadPool::run(int first, int last, int chunk, const std::function<void(int,int)>& task)
+{
+  if (last < first)
+    return;
+  if (chunk < 1)
+    chunk = 1;
+  std::atomic<long long> remaining(((long long)last - first) / chunk + 1);
+  std::atomic<bool> failed(false);
+  std::mutex failure_lock;
+  std::exception_ptr failure;
+  for (long long start = first; start <= last; start += chunk) {
+    int end = (int)std::min(start + chunk - 1, (long long)last);
+    int begin = (int)start;
+    submit([&, begin, end] {
+      if (!failed) {
+        try {
+          task(begin, end);
+        }
+        catch (...) {
+          std::lock_guard<std::mutex> lock(failure_lock);
+          if (!failure)
+            failure = std::current_exception();
+          failed = true;
+        }
+      }
+      --remaining;
+    });
+  }
+  help_until([&] {return remaining == 0;});
+  if (failure)
+    std::rethrow_exception(failure);
+}
+
+
+void ThreadPool::work(size_t worker)
+{
+  worker_pool = this;
+  worker_index = worker;
+  // the thread's statistics outlive it
+  Stats::attach();
+  Job job;
+  while (true) {
+    if (take(worker, job)) {
+      run_job(job);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_lock);
+    wake.wait(lock, [this] {return stopping || pending > 0;});
+    if (stopping) {
+      Stats::detach();
+      return;
+    }
+  }
+}
+
+
+bool ThreadPool::take(size_t worker, Job& job)
+{
+  {
+    Queue& own = *queues[worker];
+    std::lock_guard<std::mutex> lock(own.lock);
+    if (!own.jobs.empty()) {
+      job = std::move(own.jobs.back());
+      own.jobs.pop_back();
+      --pending;
+      return true;
+    }
+  }
+  // steal from the other workers, starting with the next one
+  size_t workers = size();
+  for (size_t i = 1; i < workers; ++i) {
+    Queue& other = *queues[(worker + i) % workers];
+    std::lock_guard<std::mutex> lock(other.lock);
+    if (!other.jobs.empty()) {
+      job = std::move(other.jobs.front());
+      other.jobs.pop_front();
+      --pending;
+      return true;
+    }
+  }
+  return false;
+}
+
+
+#endif
@@ -17,7 +17,7 @@ enum TokenType {
   // basic symbols
 
   // *** TODO ***
-  ASSIGN, COMMA, DOT, LPAREN, RPAREN, COLON,
+  ASSIGN, COMMA, DOT, LPAREN, RPAREN, COLON, LBRACKET, RBRACKET,
   // math operators
   PLUS, MINUS, MULTIPLY, DIVIDE, MODULO, NEG,
   // logical operators
@@ -27,10 +27,12 @@ enum TokenType {
   // reserved words
 
   // *** TODO ***
-  TYPE, WHILE, FOR, TO, DO, IF, THEN, ELSEIF, ELSE, END, FUN,
-  VAR, RETURN, NEW,
+  TYPE, WHILE, FOR, PARFOR, TO, DO, IF, THEN, ELSEIF, ELSE, END, FUN,
+  VAR, RETURN, NEW, SPAWN,
   // primitive types
   BOOL_TYPE, INT_TYPE, DOUBLE_TYPE, CHAR_TYPE, STRING_TYPE, 
+  // aggregate types
+  ARRAY, VEC, MAP, PQUEUE, TASK,
   // values
   BOOL_VAL, INT_VAL, DOUBLE_VAL, STRING_VAL, CHAR_VAL, ID, NIL,
   // end-of-stream
@@ -77,41 +79,49 @@ private:
   // the column location of the start of the lexeme (starts at 1)
   int token_column;
 
-  // token type to string representation (for printing)
-  std::map<TokenType,std::string> token_type_map =
-    { // basic symbols
-
-      // *** TODO *** 
-      {ASSIGN, "ASSIGN"}, {COMMA, "COMMA"}, {DOT, "DOT"}, {LPAREN, "LPAREN"}, {RPAREN, "RPAREN"}, {COLON, "COLON"},
-      // math operators
-      {PLUS, "PLUS"}, {MINUS, "MINUS"}, {MULTIPLY, "MULTIPLY"},
-      {DIVIDE, "DIVIDE"}, {MODULO, "MODULO"}, {NEG, "NEG"},
-      {STRING_VAL, "STRING_VAL"},
-      // logical operators
-      {AND, "AND"}, {OR, "OR"}, {NOT, "NOT"},
-      // comparators
-      {EQUAL, "EQUAL"}, {GREATER, "GREATER"},
-      {GREATER_EQUAL, "GREATER_EQUAL"}, {LESS, "LESS"},
-      {LESS_EQUAL, "LESS_EQUAL"}, {NOT_EQUAL, "NOT_EQUAL"},
-      // reserved words
-
-      // *** TODO ***
-      {TYPE, "TYPE"}, {WHILE, "WHILE"}, {FOR, "FOR"}, {TO, "TO"}, {DO, "DO"}, {IF, "IF"}, {THEN, "THEN"}, {ELSEIF, "ELSEIF"}, {ELSE, "ELSE"}, {END, "END"}, {FUN, "FUN"},
-      {VAR, "VAR"}, {RETURN, "RETURN"}, {NEW, "NEW"},
-      // primitive types
-      {BOOL_TYPE, "BOOL_TYPE"}, {INT_TYPE, "INT_TYPE"},
-      {DOUBLE_TYPE, "DOUBLE_TYPE"}, {CHAR_TYPE, "CHAR_TYPE"},
-      {STRING_TYPE, "STRING_TYPE"}, 
-      // values
-      {BOOL_VAL, "BOOL_VAL"}, {INT_VAL, "INT_VAL"},
-      {DOUBLE_VAL, "DOUBLE_VAL"}, {STRING_VAL, "STRING_VAL"},
-      {CHAR_VAL, "CHAR_VAL"}, {ID, "ID"}, {NIL, "NIL"},
-      // eos
-      {EOS, "EOS"}
-    };
+  // token type to string representation (for printing), shared by
+  // all tokens
+  static const std::map<TokenType,std::string> token_type_map;
 };
 
 
+const std::map<TokenType,std::string> Token::token_type_map =
+  { // basic symbols
+
+    // *** TODO *** 
+    {ASSIGN, "ASSIGN"}, {COMMA, "COMMA"}, {DOT, "DOT"}, {LPAREN, "LPAREN"}, {RPAREN, "RPAREN"}, {COLON, "COLON"},
+    {LBRACKET, "LBRACKET"}, {RBRACKET, "RBRACKET"},
+    // math operators
+    {PLUS, "PLUS"}, {MINUS, "MINUS"}, {MULTIPLY, "MULTIPLY"},
+    {DIVIDE, "DIVIDE"}, {MODULO, "MODULO"}, {NEG, "NEG"},
+    {STRING_VAL, "STRING_VAL"},
+    // logical operators
+    {AND, "AND"}, {OR, "OR"}, {NOT, "NOT"},
+    // comparators
+    {EQUAL, "EQUAL"}, {GREATER, "GREATER"},
+    {GREATER_EQUAL, "GREATER_EQUAL"}, {LESS, "LESS"},
+    {LESS_EQUAL, "LESS_EQUAL"}, {NOT_EQUAL, "NOT_EQUAL"},
+    // reserved words
+
+    // *** TODO ***
+    {TYPE, "TYPE"}, {WHILE, "WHILE"}, {FOR, "FOR"}, {PARFOR, "PARFOR"}, {TO, "TO"}, {DO, "DO"}, {IF, "IF"}, {THEN, "THEN"}, {ELSEIF, "ELSEIF"}, {ELSE, "ELSE"}, {END, "END"}, {FUN, "FUN"},
+    {VAR, "VAR"}, {RETURN, "RETURN"}, {NEW, "NEW"}, {SPAWN, "SPAWN"},
+    // primitive types
+    {BOOL_TYPE, "BOOL_TYPE"}, {INT_TYPE, "INT_TYPE"},
+    {DOUBLE_TYPE, "DOUBLE_TYPE"}, {CHAR_TYPE, "CHAR_TYPE"},
+    {STRING_TYPE, "STRING_TYPE"}, 
+    // aggregate types
+    {ARRAY, "ARRAY"}, {VEC, "VEC"}, {MAP, "MAP"},
+    {PQUEUE, "PQUEUE"}, {TASK, "TASK"},
+    // values
+    {BOOL_VAL, "BOOL_VAL"}, {INT_VAL, "INT_VAL"},
+    {DOUBLE_VAL, "DOUBLE_VAL"}, {STRING_VAL, "STRING_VAL"},
+    {CHAR_VAL, "CHAR_VAL"}, {ID, "ID"}, {NIL, "NIL"},
+    // eos
+    {EOS, "EOS"}
+  };
+
+
 Token::Token()
   : token_type(EOS), token_lexeme(""), token_line(0), token_column(0)
 {
@@ -0,0 +1,145 @@
+//----------------------------------------------------------------------
+// NAME: Charles Walker
+// FILE: tracer.h
+// DATE: Spring 2021
+// DESC: Call tracing for MyPL programs (mypl --trace=FILE). While
+//       tracing is on, every call expression (user-defined functions
+//       and built-ins like print and read) records its start and end
+//       time into a ring buffer allocated up front, so the newest
+//       calls are kept if the buffer fills. At the end of the run the
+//       calls are written as Chrome trace-event JSON, which
+//       chrome://tracing and ui.perfetto.dev display as a timeline
+//       per thread. When tracing is off, a call only checks a flag.
+//----------------------------------------------------------------------
+
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ostream>
+#include <vector>
+#include "ast.h"
+
+
+class Tracer
+{
+public:
+
+  // true while calls are being recorded
+  static bool enabled;
+
+  // start recording, keeping up to the given number of calls
+  static void start(size_t capacity = 1 << 20);
+
+  // stop recording
+  static void stop();
+
+  // write the recorded calls as trace-event JSON
+  static void write_json(std::ostream& out);
+
+  // the start time of a call (-1 if tracing is off)
+  static long long call_start();
+
+  // record a call that started at the given time (user is true for
+  // calls of user-defined functions)
+  static void call_end(const CallExpr& call, long long start, bool user);
+
+private:
+
+  struct Event {
+    const CallExpr* call;
+    long long start;    // ns since the trace started
+    long long end;
+    int thread;
+    bool user;
+  };
+
+  // the ring buffer and the number of calls recorded so far
+  static std::vector<Event> events;
+  static std::atomic<size_t> recorded;
+
+  static std::chrono::steady_clock::time_point origin;
+
+  // the id of each thread (0 until the thread records a call)
+  static std::atomic<int> thread_count;
+  static thread_local int thread_id;
+
+  // ns since the trace started
+  static long long now();
+};
+
+
+bool Tracer::enabled = false;
+std::vector<Tracer::Event> Tracer::events;
+std::atomic<size_t> Tracer::recorded {0};
+std::chrono::steady_clock::time_point Tracer::origin;
+std::atomic<int> Tracer::thread_count {0};
+thread_local int Tracer::thread_id;
+
+
+void Tracer::start(size_t capacity)
+{
+  events.assign(std::max(capacity, (size_t)1), Event());
+  recorded = 0;
+  origin = std::chrono::steady_clock::now();
+  enabled = true;
+}
+
+
+void Tracer::stop()
+{
+  enabled = false;
+}
+
+
+long long Tracer::now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now() - origin).count();
+}
+
+
+long long Tracer::call_start()
+{
+  return enabled ? now() : -1;
+}
+
+
+void Tracer::call_end(const CallExpr& call, long long start, bool user)
+{
+  if (start < 0)
+    return;
+  if (thread_id == 0)
+    thread_id = ++thread_count;
+  size_t i = recorded.fetch_add(1) % events.size();
+  events[i] = {&call, start, now(), thread_id, user};
+}
+
+
+void Tracer::write_json(std::ostream& out)
+{
+  size_t total = recorded;
+  size_t count = std::min(total, events.size());
+  // the calls end in order, so the ones kept are the newest
+  out << "{\"traceEvents\":[\n";
+  char buf[64];
+  for (size_t k = 0; k < count; ++k) {
+    const Event& e = events[(total - count + k) % events.size()];
+    snprintf(buf, sizeof(buf), "\"ts\":%.3f,\"dur\":%.3f", e.start / 1000.0,
+             (e.end - e.start) / 1000.0);
+    out << "{\"name\":\"" << e.call -> function_id.lexeme()
+        << "\",\"cat\":\"" << (e.user ? "call" : "builtin")
+        << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.thread << "," << buf
+        << ",\"args\":{\"line\":" << e.call -> function_id.line() << "}}"
+        << (k + 1 < count ? ",\n" : "\n");
+  }
+  out << "],\"displayTimeUnit\":\"ns\",\"otherData\":{\"calls\":" << total
+      << ",\"dropped\":" << total - count << "}}\n";
+}
+
+
+#endif
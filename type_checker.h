@@ -10,6 +10,7 @@
 #define TYPE_CHECKER_H
 
 #include <iostream>
+#include <unordered_set>
 #include "ast.h"
 #include "symbol_table.h"
 
@@ -18,9 +19,16 @@ class TypeChecker : public Visitor
 {
 public:
 
+  // false for a library of functions called by a host program
+  bool require_main = true;
+
   // top-level
   void visit(Program& node);
   void visit(Repl& node);
+
+  // drop the globals declared by the last repl input (e.g., when it
+  // fails at run time after being checked)
+  void undo_repl_input();
   void visit(FunDecl& node);
   void visit(TypeDecl& node);
   // statements
@@ -31,6 +39,7 @@ public:
   void visit(IfStmt& node);
   void visit(WhileStmt& node);
   void visit(ForStmt& node);
+  void visit(ParForStmt& node);
   // expressions
   void visit(Expr& node);
   void visit(SimpleTerm& node);
@@ -41,6 +50,11 @@ public:
   void visit(CallExpr& node);
   void visit(IDRValue& node);
   void visit(NegatedRValue& node);
+  void visit(ArrayRValue& node);
+  void visit(SpawnRValue& node);
+
+  // the symbol table (e.g., for its peak size)
+  const SymbolTable& symbol_table() const;
 
 private:
 
@@ -50,9 +64,47 @@ private:
   // the previously inferred type
   std::string curr_type;
 
+  // the environment of the outermost enclosing parfor body (or -1)
+  int parfor_env_id = -1;
+
+  // the user-defined functions (only these can be spawned)
+  std::unordered_set<std::string> user_functions;
+
+  // the global environment of a repl session (or -1), which is kept
+  // across inputs
+  int repl_env_id = -1;
+
+  // the globals declared by the last repl input
+  std::list<std::string> repl_new_names;
+
   // helper to add built in functions
   void initialize_built_in_types();
 
+  // helper to check a declared type (primitive, UDT, or array) exists
+  void check_type(const Token& type);
+
+  // helper for the element type of an array type (or "" if not an array)
+  std::string elem_type(const std::string& type) const;
+
+  // helpers for the key (or priority) and value types of a map (or
+  // pqueue) type (or "" if the type is not of that kind)
+  std::string key_type(const std::string& type, const std::string& kind = "map") const;
+  std::string val_type(const std::string& type, const std::string& kind = "map") const;
+
+  // helper for the result type of a task type (or "" if not a task)
+  std::string result_type(const std::string& type) const;
+
+  // helper to type check calls to built-ins that take any array or map
+  bool generic_call(CallExpr& node);
+
+  // helper to finish checking an expression, given the type of its
+  // first term in curr_type (checks its not or its operator)
+  void check_expr(Expr& node);
+
+  // helper to reject a write to a variable declared outside of the
+  // enclosing parfor body (iterations may run at the same time)
+  void check_shared_write(const Token& var);
+
   // error message
   void error(const std::string& msg, const Token& token);
   void error(const std::string& msg); 
@@ -60,6 +112,12 @@ private:
 };
 
 
+const SymbolTable& TypeChecker::symbol_table() const
+{
+  return sym_table;
+}
+
+
 void TypeChecker::error(const std::string& msg, const Token& token)
 {
   throw MyPLException(SEMANTIC, msg, token.line(), token.column());
@@ -94,33 +152,273 @@ void TypeChecker::initialize_built_in_types()
   sym_table.set_vec_info("dtos", StringVec {"double", "string"});
   // get
   sym_table.add_name("get");
-  sym_table.set_vec_info("get", StringVec {"string", "char"});
+  sym_table.set_vec_info("get", StringVec {"int", "string", "char"});
   // length
   sym_table.add_name("length");
   sym_table.set_vec_info("length", StringVec {"string", "int"});
   //read
   sym_table.add_name("read");
-  sym_table.set_vec_info("read", StringVec {"string", "nil"});
+  sym_table.set_vec_info("read", StringVec {"string"});
+  // find (index of the second string in the first, or -1)
+  sym_table.add_name("find");
+  sym_table.set_vec_info("find", StringVec {"string", "string", "int"});
+  // count (occurrences of a char)
+  sym_table.add_name("count");
+  sym_table.set_vec_info("count", StringVec {"string", "char", "int"});
+  // starts_with
+  sym_table.add_name("starts_with");
+  sym_table.set_vec_info("starts_with", StringVec {"string", "string", "bool"});
+  // compare (-1, 0, or 1)
+  sym_table.add_name("compare");
+  sym_table.set_vec_info("compare", StringVec {"string", "string", "int"});
+  // upper and lower
+  sym_table.add_name("upper");
+  sym_table.set_vec_info("upper", StringVec {"string", "string"});
+  sym_table.add_name("lower");
+  sym_table.set_vec_info("lower", StringVec {"string", "string"});
+  // split_count (number of fields separated by a char)
+  sym_table.add_name("split_count");
+  sym_table.set_vec_info("split_count", StringVec {"string", "char", "int"});
+  // size, put, has, remove, push, pop, and peek take any array, map,
+  // or pqueue, so they are checked in generic_call (the names are
+  // reserved here)
+  sym_table.add_name("size");
+  sym_table.add_name("put");
+  sym_table.add_name("has");
+  sym_table.add_name("remove");
+  sym_table.add_name("push");
+  sym_table.add_name("pop");
+  sym_table.add_name("peek");
+  // add and mul (in place, e.g., add(a, b) is a = a + b)
+  sym_table.add_name("add");
+  sym_table.set_vec_info("add", StringVec {"vec", "vec", "nil"});
+  sym_table.add_name("mul");
+  sym_table.set_vec_info("mul", StringVec {"vec", "vec", "nil"});
+  // dot, sum, and norm (vec reductions)
+  sym_table.add_name("dot");
+  sym_table.set_vec_info("dot", StringVec {"vec", "vec", "double"});
+  sym_table.add_name("sum");
+  sym_table.set_vec_info("sum", StringVec {"vec", "double"});
+  sym_table.add_name("norm");
+  sym_table.set_vec_info("norm", StringVec {"vec", "double"});
+  // join (waits for a spawned task) takes any task, so it is checked
+  // in generic_call
+  sym_table.add_name("join");
 
 }
 
+void TypeChecker::check_type(const Token& type)
+{
+  std::string t = type.lexeme();
+  if (t == "int" || t == "double" || t == "bool" || t == "char" || t == "string" || t == "vec")
+    return;
+  if (elem_type(t) != "")
+    return check_type(Token(type.type(), elem_type(t), type.line(), type.column()));
+  if (result_type(t) == "nil")
+    return;
+  if (result_type(t) != "")
+    return check_type(Token(type.type(), result_type(t), type.line(), type.column()));
+  if (key_type(t) != "")
+  {
+    if (key_type(t) != "int" && key_type(t) != "string")
+      error("Map keys must be int or string, got " + key_type(t), type);
+    return check_type(Token(type.type(), val_type(t), type.line(), type.column()));
+  }
+  if (key_type(t, "pqueue") != "")
+  {
+    if (key_type(t, "pqueue") != "int" && key_type(t, "pqueue") != "double")
+      error("Priorities must be int or double, got " + key_type(t, "pqueue"), type);
+    return check_type(Token(type.type(), val_type(t, "pqueue"), type.line(), type.column()));
+  }
+  if (!sym_table.has_map_info(t))
+    error("UDT " + t + " does not exist", type);
+}
+
+
+std::string TypeChecker::elem_type(const std::string& type) const
+{
+  // a vec is indexed like an array of doubles
+  if (type == "vec")
+    return "double";
+  if (type.compare(0, 6, "array ") != 0)
+    return "";
+  return type.substr(6);
+}
+
+
+std::string TypeChecker::result_type(const std::string& type) const
+{
+  if (type.compare(0, 5, "task ") != 0)
+    return "";
+  return type.substr(5);
+}
+
+
+std::string TypeChecker::key_type(const std::string& type, const std::string& kind) const
+{
+  size_t start = kind.size() + 1;
+  if (type.compare(0, start, kind + " ") != 0)
+    return "";
+  return type.substr(start, type.find(' ', start) - start);
+}
+
+
+std::string TypeChecker::val_type(const std::string& type, const std::string& kind) const
+{
+  size_t start = kind.size() + 1;
+  if (type.compare(0, start, kind + " ") != 0)
+    return "";
+  return type.substr(type.find(' ', start) + 1);
+}
+
+
+bool TypeChecker::generic_call(CallExpr& node)
+{
+  std::string fun_name = node.function_id.lexeme();
+  if (fun_name == "size")
+  {
+    if (node.arg_list.size() != 1)
+      error("Fun Call requires 1 arguments, got " + std::to_string(node.arg_list.size()), node.function_id);
+    node.arg_list.front()->accept(*this);
+    if (elem_type(curr_type) == "" && key_type(curr_type) == "" && key_type(curr_type, "pqueue") == "")
+      error("Expected array, map, or pqueue, got " + curr_type, node.function_id);
+    curr_type = "int";
+    return true;
+  }
+  // join(t) waits for a task and gives its function's result
+  if (fun_name == "join")
+  {
+    if (node.arg_list.size() != 1)
+      error("Fun Call requires 1 arguments, got " + std::to_string(node.arg_list.size()), node.function_id);
+    node.arg_list.front()->accept(*this);
+    if (result_type(curr_type) == "")
+      error("Expected task, got " + curr_type, node.function_id);
+    curr_type = result_type(curr_type);
+    return true;
+  }
+  // map built-ins: get(m, k), has(m, k), remove(m, k), put(m, k, v)
+  if (fun_name == "get" || fun_name == "has" || fun_name == "remove" || fun_name == "put")
+  {
+    size_t args = fun_name == "put" ? 3 : 2;
+    if (node.arg_list.size() != args)
+    {
+      // get(int, string) is the string built-in
+      if (fun_name == "get")
+        return false;
+      error("Fun Call requires " + std::to_string(args) + " arguments, got " + std::to_string(node.arg_list.size()), node.function_id);
+    }
+    std::list<Expr*>::iterator arg = node.arg_list.begin();
+    (*arg)->accept(*this);
+    std::string map_type = curr_type;
+    if (key_type(map_type) == "")
+    {
+      if (fun_name == "get")
+        return false;
+      error("Expected map, got " + map_type, node.function_id);
+    }
+    (*++arg)->accept(*this);
+    if (curr_type != key_type(map_type))
+      error("Expected " + key_type(map_type) + " key, got " + curr_type, node.function_id);
+    if (fun_name == "put")
+    {
+      (*++arg)->accept(*this);
+      if (curr_type != val_type(map_type) && curr_type != "nil")
+        error("Expected " + val_type(map_type) + " value, got " + curr_type, node.function_id);
+      curr_type = "nil";
+    }
+    else if (fun_name == "get")
+      curr_type = val_type(map_type);
+    else
+      curr_type = "bool";
+    return true;
+  }
+  // pqueue built-ins: push(q, p, v), pop(q), and peek(q)
+  if (fun_name == "push" || fun_name == "pop" || fun_name == "peek")
+  {
+    size_t args = fun_name == "push" ? 3 : 1;
+    if (node.arg_list.size() != args)
+      error("Fun Call requires " + std::to_string(args) + " arguments, got " + std::to_string(node.arg_list.size()), node.function_id);
+    std::list<Expr*>::iterator arg = node.arg_list.begin();
+    (*arg)->accept(*this);
+    std::string queue_type = curr_type;
+    if (key_type(queue_type, "pqueue") == "")
+      error("Expected pqueue, got " + queue_type, node.function_id);
+    if (fun_name == "push")
+    {
+      (*++arg)->accept(*this);
+      if (curr_type != key_type(queue_type, "pqueue"))
+        error("Expected " + key_type(queue_type, "pqueue") + " priority, got " + curr_type, node.function_id);
+      (*++arg)->accept(*this);
+      if (curr_type != val_type(queue_type, "pqueue") && curr_type != "nil")
+        error("Expected " + val_type(queue_type, "pqueue") + " value, got " + curr_type, node.function_id);
+      curr_type = "nil";
+    }
+    else
+      curr_type = val_type(queue_type, "pqueue");
+    return true;
+  }
+  return false;
+}
+
+
+void TypeChecker::check_shared_write(const Token& var)
+{
+  if (parfor_env_id != -1 && !sym_table.name_exists_since_env(var.lexeme(), parfor_env_id))
+    error("Cannot modify shared var " + var.lexeme() + " in parfor body", var);
+}
+
 //----------------------------------------------------------------------
 // Function, Variable, and Type Declarations
 //----------------------------------------------------------------------
 void TypeChecker::visit(Repl& node)
 {
-    // push the global environment
-
-  sym_table.push_environment();
-  // add built-in functions
-  initialize_built_in_types();
+  // push the global environment (on the first input of the session)
+  if (repl_env_id == -1) {
+    sym_table.push_environment();
+    // add built-in functions
+    initialize_built_in_types();
+    repl_env_id = sym_table.get_environment_id();
+  }
+  // the globals this input declares
+  repl_new_names.clear();
+  for (Decl* d : node.decls) {
+    if (FunDecl* f = dynamic_cast<FunDecl*>(d))
+      repl_new_names.push_back(f->id.lexeme());
+    else if (TypeDecl* t = dynamic_cast<TypeDecl*>(d))
+      repl_new_names.push_back(t->id.lexeme());
+  }
+  for (Stmt* s : node.stmts)
+    if (VarDeclStmt* v = dynamic_cast<VarDeclStmt*>(s))
+      repl_new_names.push_back(v->id.lexeme());
+  repl_new_names.remove_if([this](const std::string& name) {
+    return sym_table.name_exists_in_curr_env(name);
+  });
+  try {
+    for (Decl* d : node.decls)
+      d->accept(*this);
+    //Continue to statements
+    for(Stmt* s : node.stmts)
+      s->accept(*this);
+  }
+  catch (MyPLException& e) {
+    // a rejected input leaves no trace in the session
+    undo_repl_input();
+    throw;
+  }
+}
 
-  //Continue to statements
-  for(Stmt* s : node.stmts)
-    s->accept(*this);
-    
-   // pop the global environment
-  sym_table.pop_environment();
+void TypeChecker::undo_repl_input()
+{
+  if (repl_env_id == -1)
+    return;
+  while (sym_table.get_environment_id() != repl_env_id)
+    sym_table.pop_environment();
+  parfor_env_id = -1;
+  for (const std::string& name : repl_new_names) {
+    sym_table.remove_name(name);
+    user_functions.erase(name);
+  }
+  repl_new_names.clear();
 }
 
 void TypeChecker::visit(Program& node)
@@ -133,18 +431,19 @@ void TypeChecker::visit(Program& node)
   // push 
   for (Decl* d : node.decls)
     d->accept(*this);
-  // check for a main function
+  // check for a main function (a library need not have one)
   if (sym_table.name_exists("main") and sym_table.has_vec_info("main")) {
     // TODO: finish checking that the main function is defined with
     // the correct signature
     StringVec main_info;
     sym_table.get_vec_info("main", main_info);
 
-    //  Ensure that main function has no parameters
-    if (main_info.size() > 0)
+    //  Ensure that main function has no parameters (the last entry
+    //  is the return type)
+    if (main_info.size() > 1)
       error("Main function should have no parameters");
   }
-  else {
+  else if (require_main) {
     // NOTE: the only time the 1-argument version of error should be
     // called!
     error("undefined 'main' function");
@@ -156,59 +455,36 @@ void TypeChecker::visit(Program& node)
 // TODO: Implement the remaining visitor functions
 void TypeChecker::visit(FunDecl& node)
 {
-  bool return_nil = false;
-  std::string return_stmt_type;
   //  Check that function isnt already declared
   if (sym_table.name_exists_in_curr_env(node.id.lexeme()))
     error("Redeclaration of function ", node.id);
 
-  if (node.return_type.lexeme() == "nil")
-    return_nil = true;
+  //  Check return and parameter types
+  if (node.return_type.lexeme() != "nil")
+    check_type(node.return_type);
 
-  //  Check return type
-  if ( node.return_type.lexeme() != "int" && node.return_type.lexeme() != "double"
-     && node.return_type.lexeme() != "char" && node.return_type.lexeme() != "string"
-     && node.return_type.lexeme() != "bool" && node.return_type.lexeme() != "nil")
-  {
-    //  Check if name is a UDT
-    if ( !(sym_table.name_exists_in_curr_env(node.return_type.lexeme())) )
-      error("Invalid return type: ", node.return_type);
-  }
-
-  //return type nil has no return stmt
-  if (return_nil)
-  {
-    if (sym_table.name_exists_in_curr_env("return") && sym_table.has_str_info("return"))
-      error("Cannot return a value when return type is nil");
-  }
-  else
-  {
-    if (sym_table.name_exists_in_curr_env("return") && sym_table.has_str_info("return"))
-    {
-      sym_table.get_str_info("return", return_stmt_type);
-      // check matching return types
-      if (node.return_type.lexeme() != return_stmt_type && return_stmt_type != "nil")
-        error("Return type and returned value do not match: "+node.return_type.lexeme()+" and "+return_stmt_type, node.return_type);
-    }
-  }
   StringVec the_type;
-  
-  //to get parameters
-  for(auto vars = node.params.begin(); vars != node.params.end(); ++vars)
+  for (FunDecl::FunParam param : node.params)
   {
-  	sym_table.add_name(vars->id.lexeme());
-  	sym_table.set_str_info(vars->id.lexeme(), vars->type.lexeme());//add type to var name
-    the_type.push_back(vars->type.lexeme());
+    check_type(param.type);
+    the_type.push_back(param.type.lexeme());
   }
-  
   the_type.push_back(node.return_type.lexeme());//add return type
   sym_table.add_name(node.id.lexeme());//add function name
   sym_table.set_vec_info(node.id.lexeme(), the_type);//add type and params
+  user_functions.insert(node.id.lexeme());
   
   sym_table.push_environment();//push environment
+
+  //parameters are local to the function body
+  for (FunDecl::FunParam param : node.params)
+  {
+    sym_table.add_name(param.id.lexeme());
+    sym_table.set_str_info(param.id.lexeme(), param.type.lexeme());
+  }
   
   //FUNCTION BODY
-  sym_table.add_name("return");//add new return value for later checking
+  sym_table.add_name("return");//declared return type, checked by return stmts
   sym_table.set_str_info("return", node.return_type.lexeme());
   
   //Continue to statements
@@ -249,12 +525,9 @@ void TypeChecker::visit(ReplEndpoint& node)
 
 void TypeChecker::visit(VarDeclStmt& node)
 {
-	//check that type is UDT first
-  if(node.type != nullptr && node.type->lexeme() != "nil" && node.type->lexeme()  != "int" && node.type->lexeme()  
-    != "double" && node.type->lexeme()  != "bool" && node.type->lexeme()  != "string" && node.type->lexeme()  != "char") {
-    if(sym_table.name_exists(node.type->lexeme()) == false)
-      error("UDT " + node.type->lexeme() + " does not exist", node.id);
-  }
+	//check that the declared type exists first
+  if(node.type != nullptr)
+    check_type(*node.type);
   node.expr->accept(*this);
 
   //then check if explicitly defined and value is nil
@@ -307,6 +580,20 @@ void TypeChecker :: visit (AssignStmt & node)
     //continue to traverser through path
 		++i;
   }
+  //only array elements of shared vars can be written in a parfor
+  if (node.indices.empty())
+    check_shared_write(node.lvalue_list.front());
+  //array element (each index is into the element of the one before)
+  for (Expr* e : node.indices)
+  {
+    std::string array_type = curr_type;
+    e->accept(*this);
+    if (curr_type != "int")
+      error("Array index must be int, got " + curr_type, node.lvalue_list.front());
+    if (elem_type(array_type) == "")
+      error("Cannot index a non-array type " + array_type, node.lvalue_list.front());
+    curr_type = elem_type(array_type);
+  }
   //lhs must match rhs
   //infer lhs type
   std::string lhs_type = curr_type;
@@ -323,10 +610,18 @@ void TypeChecker :: visit (AssignStmt & node)
 
 void TypeChecker::visit(ReturnStmt& node)
 {
+  if (parfor_env_id != -1)
+    error("Cannot return from a parfor body", node.expr->first_token());
   node.expr->accept(*this);
-  sym_table.add_name("return");
-  sym_table.set_str_info("return", curr_type);
-
+  // outside of a function (the repl) there is no declared type
+  if (!sym_table.has_str_info("return"))
+    return;
+  std::string return_type;
+  sym_table.get_str_info("return", return_type);
+  if (return_type == "nil" && curr_type != "nil")
+    error("Cannot return a value when return type is nil", node.expr->first_token());
+  if (curr_type != return_type && curr_type != "nil")
+    error("Return type and returned value do not match: "+return_type+" and "+curr_type, node.expr->first_token());
 }
 
 void TypeChecker::visit(IfStmt& node)
@@ -395,34 +690,67 @@ void TypeChecker::visit(ForStmt& node)
   if(curr_type != "int")
     error("For loop start and end expressions must be int, got ", node.end->first_token());
 
-  //typecheck body
+  //typecheck body (with the loop variable in scope)
   sym_table.push_environment();
+  sym_table.add_name(node.var_id.lexeme());
+  sym_table.set_str_info(node.var_id.lexeme(), "int");
   for (Stmt* s : node.stmts)
     s->accept(*this);
   sym_table.pop_environment();
 }
 
+void TypeChecker::visit(ParForStmt& node)
+{
+  //checked like a for loop
+  node.start->accept(*this);
+  if(curr_type != "int")
+    error("Parfor loop start and end expressions must be int, got ", node.end->first_token());
+
+  node.end->accept(*this);
+  if(curr_type != "int")
+    error("Parfor loop start and end expressions must be int, got ", node.end->first_token());
+
+  //the body may only write to vars declared within it
+  int outer_parfor_env_id = parfor_env_id;
+  sym_table.push_environment();
+  if (parfor_env_id == -1)
+    parfor_env_id = sym_table.get_environment_id();
+  sym_table.add_name(node.var_id.lexeme());
+  sym_table.set_str_info(node.var_id.lexeme(), "int");
+  for (Stmt* s : node.stmts)
+    s->accept(*this);
+  sym_table.pop_environment();
+  parfor_env_id = outer_parfor_env_id;
+}
+
 //----------------------------------------------------------------------
 // Expressions and Expression Terms
 //----------------------------------------------------------------------
 
 void TypeChecker::visit(Expr& node)
+{
+  // the first terms nesting other expressions (as in a long a + b + c
+  // ...) are checked from the innermost expression out
+  std::vector<Expr*> spine;
+  left_spine(node, spine);
+  spine.back()->first->accept(*this);
+  for (auto e = spine.rbegin(); e != spine.rend(); ++e)
+    check_expr(**e);
+}
+
+void TypeChecker::check_expr(Expr& node)
 {
   //check
   if (node.op == nullptr)
   {
     //  Get type of expr
-    node.first->accept(*this);
-
     //  If the expr is negated ensure that the expression is a boolean
-    node.first->accept(*this);
     if (node.negated && curr_type != "bool")
       error("Not should be used , got "+curr_type, node.first_token());
   }
   else 
   {
-    //typecheck lhs of expr
-    node.first->accept(*this);
+    //type of lhs of expr
     std::string lhs_type;
     lhs_type = curr_type;
 
@@ -471,10 +799,12 @@ void TypeChecker::visit(Expr& node)
           curr_type = "int";
         else if (lhs_type == "double" && curr_type == "double")
           curr_type = "double";
+        else if (lhs_type == "vec" && curr_type == "vec")
+          curr_type = "vec";
         else if (lhs_type == "char" || lhs_type == "string")
         {
             if (curr_type == "char" || curr_type == "string")
-              curr_type == "string";
+              curr_type = "string";
 
             else
               error("Can only add strings and chars not "+lhs_type+" and "+curr_type, node.first_token());
@@ -493,9 +823,22 @@ void TypeChecker::visit(Expr& node)
           curr_type = "int";
         else if(lhs_type == "double" && curr_type == "double")
           curr_type = "double";
+        //vec - vec, vec * vec, and vec * double (either order)
+        else if(node.op->type() == MINUS && lhs_type == "vec" && curr_type == "vec")
+          curr_type = "vec";
+        else if(node.op->type() == MULTIPLY && (lhs_type == "vec" || curr_type == "vec") &&
+                (lhs_type == "double" || lhs_type == "vec") && (curr_type == "double" || curr_type == "vec"))
+          curr_type = "vec";
         else
           error("Cannot operate between types "+lhs_type+" and " +curr_type, node.first_token());
       }
+      // logical ops
+      else if(node.op->type() == AND || node.op->type() == OR)
+      {
+        if (lhs_type != "bool" || curr_type != "bool")
+          error("Expecting bool operands for "+node.op->lexeme()+" not "+lhs_type+" and "+curr_type, node.first_token());
+        curr_type = "bool";
+      }
     }
   }
 }
@@ -534,6 +877,32 @@ void TypeChecker :: visit ( SimpleRValue & node )
 
 void TypeChecker::visit(NewRValue& node)
 {
+  //map and pqueue creation
+  if ((node.type_id.type() == MAP || node.type_id.type() == PQUEUE) && node.array_size == nullptr)
+  {
+    check_type(node.type_id);
+    curr_type = node.type_id.lexeme();
+    return;
+  }
+  //vec creation
+  if (node.vec_length != nullptr)
+  {
+    node.vec_length->accept(*this);
+    if (curr_type != "int")
+      error("Vec length must be int, got " + curr_type, node.type_id);
+    curr_type = "vec";
+    return;
+  }
+  //array creation
+  if (node.array_size != nullptr)
+  {
+    check_type(node.type_id);
+    node.array_size->accept(*this);
+    if (curr_type != "int")
+      error("Array size must be int, got " + curr_type, node.type_id);
+    curr_type = "array " + node.type_id.lexeme();
+    return;
+  }
   if (sym_table.name_exists(node.type_id.lexeme()))
   {
     //type must have data mapped
@@ -548,8 +917,22 @@ void TypeChecker::visit(NewRValue& node)
 
 void TypeChecker::visit(CallExpr& node)
 {
+  //built-ins that modify their first argument
+  std::string fun_name = node.function_id.lexeme();
+  if (parfor_env_id != -1 && !node.arg_list.empty() &&
+      (fun_name == "put" || fun_name == "remove" || fun_name == "push" ||
+       fun_name == "pop" || fun_name == "add" || fun_name == "mul"))
+  {
+    Expr* arg = node.arg_list.front();
+    SimpleTerm* term = dynamic_cast<SimpleTerm*>(arg->first);
+    IDRValue* var = term ? dynamic_cast<IDRValue*>(term->rvalue) : nullptr;
+    if (var != nullptr && var->indices.empty() && arg->op == nullptr)
+      check_shared_write(var->path.front());
+  }
+  if (generic_call(node))
+    return;
   //function must be in scope
-  if(!sym_table.name_exists(node.function_id.lexeme()))
+  if(!sym_table.has_vec_info(node.function_id.lexeme()))
     error("Function does not exist: ", node.function_id);
 
   StringVec fun_type;
@@ -602,19 +985,52 @@ void TypeChecker::visit(IDRValue& node)
   	prev_type = curr_type;
 		++i;
   }
+  //array element (each index is into the element of the one before)
+  for (Expr* e : node.indices)
+  {
+    std::string array_type = curr_type;
+    e->accept(*this);
+    if (curr_type != "int")
+      error("Array index must be int, got " + curr_type, node.first_token());
+    if (elem_type(array_type) == "")
+      error("Cannot index a non-array type " + array_type, node.first_token());
+    curr_type = elem_type(array_type);
+  }
 }
 
 void TypeChecker::visit(NegatedRValue& node)
 {
   node.expr->accept(*this);
   // expr must be type int or double
-  if (curr_type != "int" || curr_type != "double")
+  if (curr_type != "int" && curr_type != "double")
     error("Expecting int or double for negation, not "+curr_type, node.expr->first_token());
-
-  node.expr->accept(*this);
 }
 
+void TypeChecker::visit(ArrayRValue& node)
+{
+  //elements must all have the same type (nil allowed for udts/arrays)
+  std::string type = "nil";
+  for (Expr* e : node.elements)
+  {
+    e->accept(*this);
+    if (type == "nil")
+      type = curr_type;
+    else if (curr_type != type && curr_type != "nil")
+      error("Array elements must have the same type, got " + type + " and " + curr_type, e->first_token());
+  }
+  if (type == "nil")
+    error("Cannot infer the element type of an array literal", node.bracket);
+  curr_type = "array " + type;
+}
 
+void TypeChecker::visit(SpawnRValue& node)
+{
+  //only user-defined functions run as tasks
+  if (user_functions.count(node.call->function_id.lexeme()) == 0)
+    error("Can only spawn user-defined functions, got " + node.call->function_id.lexeme(), node.call->function_id);
+  node.call->accept(*this);
+  curr_type = "task " + curr_type;
+}
 
 
 #endif
@@ -0,0 +1,293 @@
+//----------------------------------------------------------------------
+// NAME: Charles Walker
+// FILE: vec_kernels.h
+// DATE: Spring 2021
+// DESC: Vectorized kernels behind the MyPL vec type (the whole-vector
+//       +, -, and * operators and the dot, sum, and norm built-ins).
+//       Each kernel has a scalar, SSE2, and AVX2 version; the widest
+//       one the CPU supports is chosen at run time (see
+//       cpu_features.h). The reductions keep several partial sums,
+//       so their results can differ from a left-to-right loop in the
+//       last bits.
+//----------------------------------------------------------------------
+
+
+#ifndef VEC_KERNELS_H
+#define VEC_KERNELS_H
+
+#include <cstddef>
+#include <cmath>
+#include "cpu_features.h"
+
+#ifdef MYPL_X86
+#include <immintrin.h>
+#endif
+
+
+class VecKernels
+{
+public:
+
+  // the element-wise operations (+, -, or *) on a[0..n) and b[0..n),
+  // written to out[0..n); out may equal a or b
+  enum Op {ADD, SUB, MUL};
+  static void apply(Op op, const double* a, const double* b, double* out, size_t n);
+
+  // out[i] = a[i] * s for i in [0, n); out may equal a
+  static void scale(const double* a, double s, double* out, size_t n);
+
+  // the dot product of a[0..n) and b[0..n)
+  static double dot(const double* a, const double* b, size_t n);
+
+  // the sum of a[0..n)
+  static double sum(const double* a, size_t n);
+
+  // the euclidean norm of a[0..n)
+  static double norm(const double* a, size_t n);
+
+private:
+
+  static void scalar_apply(Op op, const double* a, const double* b, double* out, size_t n);
+  static void scalar_scale(const double* a, double s, double* out, size_t n);
+  static double scalar_dot(const double* a, const double* b, size_t n);
+  static double scalar_sum(const double* a, size_t n);
+
+#ifdef MYPL_X86
+  static void sse2_apply(Op op, const double* a, const double* b, double* out, size_t n);
+  static void sse2_scale(const double* a, double s, double* out, size_t n);
+  static double sse2_dot(const double* a, const double* b, size_t n);
+  static double sse2_sum(const double* a, size_t n);
+
+  __attribute__((target("avx2")))
+  static void avx2_apply(Op op, const double* a, const double* b, double* out, size_t n);
+  __attribute__((target("avx2")))
+  static void avx2_scale(const double* a, double s, double* out, size_t n);
+  __attribute__((target("avx2")))
+  static double avx2_dot(const double* a, const double* b, size_t n);
+  __attribute__((target("avx2")))
+  static double avx2_sum(const double* a, size_t n);
+#endif
+};
+
+
+//----------------------------------------------------------------------
+// Dispatch
+//----------------------------------------------------------------------
+
+void VecKernels::apply(Op op, const double* a, const double* b, double* out, size_t n)
+{
+#ifdef MYPL_X86
+  if (CPUFeatures::avx2())
+    return avx2_apply(op, a, b, out, n);
+  if (CPUFeatures::sse2())
+    return sse2_apply(op, a, b, out, n);
+#endif
+  scalar_apply(op, a, b, out, n);
+}
+
+
+void VecKernels::scale(const double* a, double s, double* out, size_t n)
+{
+#ifdef MYPL_X86
+  if (CPUFeatures::avx2())
+    return avx2_scale(a, s, out, n);
+  if (CPUFeatures::sse2())
+    return sse2_scale(a, s, out, n);
+#endif
+  scalar_scale(a, s, out, n);
+}
+
+
+double VecKernels::dot(const double* a, const double* b, size_t n)
+{
+#ifdef MYPL_X86
+  if (CPUFeatures::avx2())
+    return avx2_dot(a, b, n);
+  if (CPUFeatures::sse2())
+    return sse2_dot(a, b, n);
+#endif
+  return scalar_dot(a, b, n);
+}
+
+
+double VecKernels::sum(const double* a, size_t n)
+{
+#ifdef MYPL_X86
+  if (CPUFeatures::avx2())
+    return avx2_sum(a, n);
+  if (CPUFeatures::sse2())
+    return sse2_sum(a, n);
+#endif
+  return scalar_sum(a, n);
+}
+
+
+double VecKernels::norm(const double* a, size_t n)
+{
+  return std::sqrt(dot(a, a, n));
+}
+
+
+//----------------------------------------------------------------------
+// Scalar kernels
+//----------------------------------------------------------------------
+
+void VecKernels::scalar_apply(Op op, const double* a, const double* b, double* out, size_t n)
+{
+  if (op == ADD)
+    for (size_t i = 0; i < n; ++i)
+      out[i] = a[i] + b[i];
+  else if (op == SUB)
+    for (size_t i = 0; i < n; ++i)
+      out[i] = a[i] - b[i];
+  else
+    for (size_t i = 0; i < n; ++i)
+      out[i] = a[i] * b[i];
+}
+
+
+void VecKernels::scalar_scale(const double* a, double s, double* out, size_t n)
+{
+  for (size_t i = 0; i < n; ++i)
+    out[i] = a[i] * s;
+}
+
+
+double VecKernels::scalar_dot(const double* a, const double* b, size_t n)
+{
+  double total = 0.0;
+  for (size_t i = 0; i < n; ++i)
+    total += a[i] * b[i];
+  return total;
+}
+
+
+double VecKernels::scalar_sum(const double* a, size_t n)
+{
+  double total = 0.0;
+  for (size_t i = 0; i < n; ++i)
+    total += a[i];
+  return total;
+}
+
+
+#ifdef MYPL_X86
+
+//----------------------------------------------------------------------
+// SSE2 kernels (2 doubles at a time)
+//----------------------------------------------------------------------
+
+void VecKernels::sse2_apply(Op op, const double* a, const double* b, double* out, size_t n)
+{
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128d x = _mm_loadu_pd(a + i);
+    __m128d y = _mm_loadu_pd(b + i);
+    __m128d z = op == ADD ? _mm_add_pd(x, y) : (op == SUB ? _mm_sub_pd(x, y) : _mm_mul_pd(x, y));
+    _mm_storeu_pd(out + i, z);
+  }
+  scalar_apply(op, a + i, b + i, out + i, n - i);
+}
+
+
+void VecKernels::sse2_scale(const double* a, double s, double* out, size_t n)
+{
+  const __m128d factor = _mm_set1_pd(s);
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2)
+    _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(a + i), factor));
+  scalar_scale(a + i, s, out + i, n - i);
+}
+
+
+double VecKernels::sse2_dot(const double* a, const double* b, size_t n)
+{
+  // two accumulators to hide the add latency
+  __m128d acc0 = _mm_setzero_pd();
+  __m128d acc1 = _mm_setzero_pd();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+  }
+  double parts[2];
+  _mm_storeu_pd(parts, _mm_add_pd(acc0, acc1));
+  return parts[0] + parts[1] + scalar_dot(a + i, b + i, n - i);
+}
+
+
+double VecKernels::sse2_sum(const double* a, size_t n)
+{
+  __m128d acc0 = _mm_setzero_pd();
+  __m128d acc1 = _mm_setzero_pd();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    acc0 = _mm_add_pd(acc0, _mm_loadu_pd(a + i));
+    acc1 = _mm_add_pd(acc1, _mm_loadu_pd(a + i + 2));
+  }
+  double parts[2];
+  _mm_storeu_pd(parts, _mm_add_pd(acc0, acc1));
+  return parts[0] + parts[1] + scalar_sum(a + i, n - i);
+}
+
+
+//----------------------------------------------------------------------
+// AVX2 kernels (4 doubles at a time)
+//----------------------------------------------------------------------
+
+void VecKernels::avx2_apply(Op op, const double* a, const double* b, double* out, size_t n)
+{
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d x = _mm256_loadu_pd(a + i);
+    __m256d y = _mm256_loadu_pd(b + i);
+    __m256d z = op == ADD ? _mm256_add_pd(x, y) : (op == SUB ? _mm256_sub_pd(x, y) : _mm256_mul_pd(x, y));
+    _mm256_storeu_pd(out + i, z);
+  }
+  scalar_apply(op, a + i, b + i, out + i, n - i);
+}
+
+
+void VecKernels::avx2_scale(const double* a, double s, double* out, size_t n)
+{
+  const __m256d factor = _mm256_set1_pd(s);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), factor));
+  scalar_scale(a + i, s, out + i, n - i);
+}
+
+
+double VecKernels::avx2_dot(const double* a, const double* b, size_t n)
+{
+  __m256d acc0 = _mm256_setzero_pd();
+  __m256d acc1 = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+  }
+  double parts[4];
+  _mm256_storeu_pd(parts, _mm256_add_pd(acc0, acc1));
+  return parts[0] + parts[1] + parts[2] + parts[3] + scalar_dot(a + i, b + i, n - i);
+}
+
+
+double VecKernels::avx2_sum(const double* a, size_t n)
+{
+  __m256d acc0 = _mm256_setzero_pd();
+  __m256d acc1 = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(a + i));
+    acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(a + i + 4));
+  }
+  double parts[4];
+  _mm256_storeu_pd(parts, _mm256_add_pd(acc0, acc1));
+  return parts[0] + parts[1] + parts[2] + parts[3] + scalar_sum(a + i, n - i);
+}
+
+#endif
+
+
+#endif